@@ -97,6 +97,12 @@ protect_mode:
 
 	call read_disk
 
+	; load the rest of kernel, edi is already after the first part
+	mov ecx, 210
+	mov bl, 200
+
+	call read_disk
+
 	; pass parameters for memory_init()
 	mov eax, 0x20240419
 	mov ebx, ards_count
@@ -104,10 +104,27 @@ void builtin_date(int argc, char *argv[]) {
 }
 
 void builtin_mount(int argc, char *argv[]) {
+    // mount [-t type] devname dirname [options]
+    char *type = NULL;
+    if (argc >= 3 && !strcmp(argv[1], "-t")) {
+        type = argv[2];
+        argc -= 2;
+        argv += 2;
+    }
     if (argc < 3) {
         return;
     }
-    mount(argv[1], argv[2], 0);
+    int flags = 0;
+    for (int i = 3; i < argc; i++) {
+        if (!strcmp(argv[i], "noatime")) {
+            flags |= MS_NOATIME;
+        } else if (!strcmp(argv[i], "relatime")) {
+            flags |= MS_RELATIME;
+        } else if (!strcmp(argv[i], "lazytime")) {
+            flags |= MS_LAZYTIME;
+        }
+    }
+    mount(argv[1], argv[2], type, flags);
 }
 
 void builtin_umount(int argc, char *argv[]) {
@@ -208,38 +225,32 @@ rollback:
 
 pid_t builtin_command(char *filename, char *argv[], fd_t infd, fd_t outfd,
                       fd_t errfd) {
-    int status;
-    pid_t pid = fork();
+    fd_t fds[3] = {infd, outfd, errfd};
 
-    // father process
-    if (pid) {
-        if (infd != EOF) {
-            close(infd);
-        }
-        if (outfd != EOF) {
-            close(outfd);
-        }
-        if (errfd != EOF) {
-            close(errfd);
+    // 子进程中将重定向的文件复制到标准输入输出，然后关闭
+    spawn_action_t actions[6];
+    int count = 0;
+    for (size_t i = 0; i < 3; i++) {
+        if (fds[i] == EOF) {
+            continue;
         }
-        return pid;
+        actions[count].type = SPAWN_DUP2;
+        actions[count].fd = fds[i];
+        actions[count].newfd = i;
+        count++;
+        actions[count].type = SPAWN_CLOSE;
+        actions[count].fd = fds[i];
+        count++;
     }
 
-    if (infd != EOF) {
-        fd_t fd = dup2(infd, STDIN_FILENO);
-        close(infd);
-    }
-    if (outfd != EOF) {
-        fd_t fd = dup2(outfd, STDOUT_FILENO);
-        close(outfd);
-    }
-    if (errfd != EOF) {
-        fd_t fd = dup2(errfd, STDERR_FILENO);
-        close(errfd);
-    }
+    pid_t pid = spawn(filename, argv, envp, actions, count);
 
-    int i = execve(filename, argv, envp);
-    exit(i);
+    for (size_t i = 0; i < 3; i++) {
+        if (fds[i] != EOF) {
+            close(fds[i]);
+        }
+    }
+    return pid;
 }
 
 void builtin_exec(int argc, char *argv[]) {
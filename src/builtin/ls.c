@@ -6,8 +6,10 @@
 #include <oak/types.h>
 
 #define BUF_LEN 1024
+#define DENTS_LEN 1024
 
 static char buf[BUF_LEN];
+static char dents[DENTS_LEN];
 
 static void strftime(time_t stamp, char *buf) {
     tm time;
@@ -91,36 +93,42 @@ int main(int argc, char const *argv[], char const *envp[]) {
         list = true;
 
     lseek(fd, 0, SEEK_SET);
-    dentry_t entry;
     while (true) {
-        int len = readdir(fd, &entry, 1);
-        if (len == EOF)
+        // 一次读取多个目录项
+        int len = getdents(fd, dents, DENTS_LEN);
+        if (len <= 0)
             break;
-        if (!entry.nr)
-            continue;
-        if (!strcmp(entry.name, ".") || !strcmp(entry.name, "..")) {
-            continue;
-        }
-        if (!list) {
-            printf("%s ", entry.name);
-            continue;
-        }
 
-        stat_t statbuf;
+        for (int pos = 0; pos < len;) {
+            getdent_t *entry = (getdent_t *)(dents + pos);
+            pos += entry->reclen;
+
+            if (!strcmp(entry->name, ".") || !strcmp(entry->name, "..")) {
+                continue;
+            }
+            if (!list) {
+                printf("%s ", entry->name);
+                continue;
+            }
 
-        stat(entry.name, &statbuf);
+            stat_t statbuf;
 
-        parsemode(statbuf.mode, buf);
-        printf("%s ", buf);
+            // 相对于打开的目录获取状态，不再重新解析路径
+            fstatat(fd, entry->name, &statbuf);
 
-        strftime(statbuf.ctime, buf);
+            parsemode(statbuf.mode, buf);
+            printf("%s ", buf);
 
-        int size = statbuf.size;
-        char qualifier;
-        reckon_size(&size, &qualifier);
+            strftime(statbuf.ctime, buf);
 
-        printf("% 2d % 2d % 2d % 4d%c %s %s\n", statbuf.nlinks, statbuf.uid,
-               statbuf.gid, size, qualifier, buf, entry.name);
+            int size = statbuf.size;
+            char qualifier;
+            reckon_size(&size, &qualifier);
+
+            printf("% 2d % 2d % 2d % 4d%c %s %s\n", statbuf.nlinks,
+                   statbuf.uid, statbuf.gid, size, qualifier, buf,
+                   entry->name);
+        }
     }
     if (!list)
         printf("\n");
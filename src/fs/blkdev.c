@@ -0,0 +1,102 @@
+#include <oak/assert.h>
+#include <oak/buffer.h>
+#include <oak/device.h>
+#include <oak/fs.h>
+#include <oak/stat.h>
+#include <oak/stdlib.h>
+#include <oak/string.h>
+#include <oak/types.h>
+
+// 直接读写时每次请求的块数，请求的扇区数不能超过 u8
+#define DIRECT_BLOCKS 64
+
+// 块设备的字节数
+static u32 blkdev_size(dev_t dev) {
+    return device_ioctl(dev, DEV_CMD_SECTOR_COUNT, NULL, 0) * SECTOR_SIZE;
+}
+
+// 不经过高速缓冲，直接读写对齐到块的数据
+static int blkdev_direct(dev_t dev, char *buf, u32 count, off_t *offset,
+                         u32 type) {
+    if (*offset % BLOCK_SIZE || count % BLOCK_SIZE) {
+        return EOF;
+    }
+
+    u32 begin = *offset;
+    u32 left = count;
+    while (left) {
+        idx_t block = *offset / BLOCK_SIZE;
+        u32 blocks = MIN(left / BLOCK_SIZE, DIRECT_BLOCKS);
+
+        device_request(dev, buf, blocks * BLOCK_SECS, block * BLOCK_SECS, 0,
+                       type);
+
+        // 高速缓冲中的块与磁盘保持一致
+        if (type == REQ_WRITE) {
+            for (size_t i = 0; i < blocks; i++) {
+                brefresh(dev, block + i, buf + i * BLOCK_SIZE);
+            }
+        }
+
+        buf += blocks * BLOCK_SIZE;
+        *offset += blocks * BLOCK_SIZE;
+        left -= blocks * BLOCK_SIZE;
+    }
+    return *offset - begin;
+}
+
+// 读写块设备文件，偏移和长度可以是任意字节，O_DIRECT 时不经过高速缓冲
+static int blkdev_rw(file_t *file, char *buf, int count, off_t *offset,
+                     u32 type) {
+    inode_t *inode = file->inode;
+    dev_t dev = inode->desc->zone[0];
+    assert(dev);
+
+    u32 size = blkdev_size(dev);
+    if (*offset >= size) {
+        return EOF;
+    }
+    count = MIN((u32)count, size - *offset);
+
+    if (file->flags & O_DIRECT) {
+        return blkdev_direct(dev, buf, count, offset, type);
+    }
+
+    u32 begin = *offset;
+    u32 left = count;
+    while (left) {
+        idx_t block = *offset / BLOCK_SIZE;
+        u32 start = *offset % BLOCK_SIZE;
+        u32 chars = MIN(BLOCK_SIZE - start, left);
+
+        buffer_t *bf = NULL;
+        if (type == REQ_WRITE && chars == BLOCK_SIZE) {
+            // 整块写入不需要先读出
+            bf = getblk(dev, block);
+            bf->valid = true;
+        } else {
+            bf = bread(dev, block);
+        }
+
+        if (type == REQ_WRITE) {
+            memcpy(bf->data + start, buf, chars);
+            bf->dirty = true;
+        } else {
+            memcpy(buf, bf->data + start, chars);
+        }
+        brelse(bf);
+
+        buf += chars;
+        *offset += chars;
+        left -= chars;
+    }
+    return *offset - begin;
+}
+
+int blkdev_read(file_t *file, char *buf, int count, off_t *offset) {
+    return blkdev_rw(file, buf, count, offset, REQ_READ);
+}
+
+int blkdev_write(file_t *file, char *buf, int count, off_t *offset) {
+    return blkdev_rw(file, buf, count, offset, REQ_WRITE);
+}
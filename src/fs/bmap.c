@@ -19,7 +19,7 @@ idx_t balloc(dev_t dev) {
         assert(buf);
 
         // 将整个缓冲区作为位图
-        bitmap_make(&map, buf->data, BLOCK_SIZE,
+        bitmap_make(&map, (u8 *)buf->data, BLOCK_SIZE,
                     i * BLOCK_BITS + sb->desc->firstdatazone - 1);
 
         // set continuous 1 bit in zmap
@@ -28,6 +28,7 @@ idx_t balloc(dev_t dev) {
             // successful, mark bufer as dirty, stop searching
             assert(bit < sb->desc->zones);
             buf->dirty = true;
+            sb->zfree--;
             break;
         }
     }
@@ -35,10 +36,46 @@ idx_t balloc(dev_t dev) {
     return bit;
 }
 
-// release a block
-void bfree(dev_t dev, idx_t idx) {
+// allocate continuous blocks, try count first, halve it if failed
+// the amount allocated is stored back to count
+idx_t balloc_run(dev_t dev, u32 *count) {
     super_block_t *sb = get_super(dev);
-    assert(sb != NULL);
+    assert(sb);
+    assert(*count > 0);
+
+    buffer_t *buf = NULL;
+    idx_t bit = EOF;
+    bitmap_t map;
+
+    for (u32 want = *count; want > 0; want >>= 1) {
+        for (size_t i = 0; i < ZMAP_NR; i++) {
+            buf = sb->zmaps[i];
+            if (!buf) {
+                break;
+            }
+
+            bitmap_make(&map, (u8 *)buf->data, BLOCK_SIZE,
+                        i * BLOCK_BITS + sb->desc->firstdatazone - 1);
+
+            bit = bitmap_scan(&map, want);
+            if (bit == EOF) {
+                continue;
+            }
+
+            // 一次分配整段，每个位图块只写一次
+            assert(bit + want <= sb->desc->zones);
+            buf->dirty = true;
+            bwrite(buf);
+            sb->zfree -= want;
+            *count = want;
+            return bit;
+        }
+    }
+    return EOF;
+}
+
+// clear the bit of block in zone bitmap, return the bitmap buffer
+static buffer_t *zmap_clear(super_block_t *sb, idx_t idx) {
     assert(idx < sb->desc->zones);
 
     buffer_t *buf;
@@ -62,11 +99,39 @@ void bfree(dev_t dev, idx_t idx) {
 
         // 标记缓冲区脏
         buf->dirty = true;
+        sb->zfree++;
         break;
     }
+    return buf;
+}
+
+// release a block
+void bfree(dev_t dev, idx_t idx) {
+    super_block_t *sb = get_super(dev);
+    assert(sb != NULL);
+
+    buffer_t *buf = zmap_clear(sb, idx);
     bwrite(buf); // todo 调试期间强同步
 }
 
+// release a block, zone bitmap is written back later by bsync
+void bclear(dev_t dev, idx_t idx) {
+    super_block_t *sb = get_super(dev);
+    assert(sb != NULL);
+
+    zmap_clear(sb, idx);
+}
+
+// write back dirty zone bitmap blocks, one write per bitmap block
+void bsync(dev_t dev) {
+    super_block_t *sb = get_super(dev);
+    assert(sb != NULL);
+
+    for (size_t i = 0; i < sb->desc->zmap_blocks; i++) {
+        bwrite(sb->zmaps[i]);
+    }
+}
+
 // allocate inode
 idx_t ialloc(dev_t dev) {
     super_block_t *sb = get_super(dev);
@@ -118,9 +183,9 @@ void ifree(dev_t dev, idx_t idx) {
 }
 
 // 获取 inode 第 block 块的索引值
-// 如果不存在 且 create 为 true，则创建
+// 如果不存在 且 create 为 true，则创建，zone 不为 0 时直接使用 zone 作为文件块
 // 即获取 zone 数组中的值
-idx_t bmap(inode_t *inode, idx_t block, bool create) {
+static idx_t zmap(inode_t *inode, idx_t block, bool create, idx_t zone) {
     // 确保 block 合法
     assert(block >= 0 && block < TOTAL_BLOCK);
 
@@ -166,7 +231,13 @@ reckon:
     for (; level >= 0; level--) {
         // 如果不存在 且 create 则申请一块文件块
         if (!array[index] && create) {
-            array[index] = balloc(inode->dev);
+            idx_t nr = (level == 0 && zone) ? zone : balloc(inode->dev);
+            // 磁盘空间不足
+            if (nr == EOF || !nr) {
+                brelse(buf);
+                return 0;
+            }
+            array[index] = nr;
             buf->dirty = true;
         }
 
@@ -185,3 +256,18 @@ reckon:
         array = (u16 *)buf->data;
     }
 }
+
+idx_t bmap(inode_t *inode, idx_t block, bool create) {
+    return zmap(inode, block, create, 0);
+}
+
+// 将 inode 第 block 块映射到文件块 zone，间接块按需分配，分配失败返回 EOF
+int bmap_assign(inode_t *inode, idx_t block, idx_t zone) {
+    assert(zone);
+    idx_t nr = zmap(inode, block, true, zone);
+    if (!nr) {
+        return EOF;
+    }
+    assert(nr == zone);
+    return 0;
+}
@@ -17,7 +17,7 @@ void dev_init() {
     assert(device);
     devmkfs(device->dev, 0);
 
-    super_block_t *sb = read_super(device->dev);
+    super_block_t *sb = read_minix_super(device->dev);
     sb->iroot = iget(device->dev, 1);
     sb->imount = namei("/dev");
     sb->imount->mount = device->dev;
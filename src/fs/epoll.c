@@ -0,0 +1,213 @@
+#include <oak/arena.h>
+#include <oak/assert.h>
+#include <oak/epoll.h>
+#include <oak/fs.h>
+#include <oak/mutex.h>
+#include <oak/stdlib.h>
+#include <oak/task.h>
+#include <oak/types.h>
+
+extern u32 volatile jiffies;
+extern u32 jiffy; // ms per jiffiy
+
+void epoll_init(epoll_t *ep) {
+    list_init(&ep->items);
+    list_init(&ep->ready);
+    wait_init(&ep->wait);
+}
+
+// 将文件加入就绪链表，唤醒等待的进程
+static void epoll_ready(epitem_t *item) {
+    if (item->ready) {
+        return;
+    }
+    item->ready = true;
+    list_pushback(&item->ep->ready, &item->rnode);
+    wait_wakeup(&item->ep->wait);
+}
+
+// 文件等待队列被唤醒时调用，不需要重新扫描所有的文件
+static void epoll_callback(wait_entry_t *entry) {
+    epitem_t *item = element_entry(epitem_t, entry, entry);
+    epoll_ready(item);
+}
+
+static epitem_t *epoll_find(epoll_t *ep, fd_t fd) {
+    list_t *list = &ep->items;
+    for (list_node_t *node = list->head.next; node != &list->tail;
+         node = node->next) {
+        epitem_t *item = element_entry(epitem_t, node, node);
+        if (item->fd == fd) {
+            return item;
+        }
+    }
+    return NULL;
+}
+
+static void epoll_remove(epitem_t *item) {
+    if (item->queue) {
+        wait_remove(&item->entry);
+    }
+    if (item->ready) {
+        list_remove(&item->rnode);
+    }
+    list_remove(&item->node);
+    put_file(item->file);
+    kfree(item);
+}
+
+void epoll_release(epoll_t *ep) {
+    while (!list_empty(&ep->items)) {
+        epitem_t *item = element_entry(epitem_t, node, ep->items.head.next);
+        epoll_remove(item);
+    }
+}
+
+static int epoll_poll(file_t *file, wait_queue_t **queue) {
+    epoll_t *ep = (epoll_t *)file->inode->desc;
+    *queue = &ep->wait;
+    return list_empty(&ep->ready) ? 0 : EPOLLIN;
+}
+
+file_op_t epoll_fop = {
+    .poll = epoll_poll,
+};
+
+static epoll_t *get_epoll(fd_t epfd) {
+    task_t *task = running_task();
+    if (epfd >= TASK_FILE_NR || !task->files[epfd]) {
+        return NULL;
+    }
+    inode_t *inode = task->files[epfd]->inode;
+    if (!inode->epoll) {
+        return NULL;
+    }
+    return (epoll_t *)inode->desc;
+}
+
+fd_t sys_epoll_create(int size) {
+    task_t *task = running_task();
+    fd_t fd = task_get_fd(task);
+    file_t *file = get_file();
+    task->files[fd] = file;
+
+    file->inode = get_epoll_inode();
+    file->flags = O_RDONLY;
+    file->mode = 0;
+    file->offset = 0;
+    return fd;
+}
+
+int sys_epoll_ctl(fd_t epfd, int op, fd_t fd, epoll_event_t *event) {
+    task_t *task = running_task();
+    epoll_t *ep = get_epoll(epfd);
+    if (!ep || fd >= TASK_FILE_NR || !task->files[fd] || fd == epfd) {
+        return EOF;
+    }
+
+    epitem_t *item = epoll_find(ep, fd);
+    switch (op) {
+    case EPOLL_CTL_ADD:
+        if (item) {
+            return EOF;
+        }
+        item = kmalloc(sizeof(epitem_t));
+        item->ep = ep;
+        item->fd = fd;
+        item->file = task->files[fd];
+        item->file->count++;
+        item->event = *event;
+        item->ready = false;
+        list_push(&ep->items, &item->node);
+
+        // 在文件的等待队列中注册回调
+        int events = file_poll(item->file, &item->queue);
+        if (item->queue) {
+            wait_add(item->queue, &item->entry);
+            item->entry.func = epoll_callback;
+        }
+        if (events & (item->event.events | EPOLLERR | EPOLLHUP)) {
+            epoll_ready(item);
+        }
+        return 0;
+    case EPOLL_CTL_MOD:
+        if (!item) {
+            return EOF;
+        }
+        item->event = *event;
+        epoll_ready(item);
+        return 0;
+    case EPOLL_CTL_DEL:
+        if (!item) {
+            return EOF;
+        }
+        epoll_remove(item);
+        return 0;
+    default:
+        return EOF;
+    }
+}
+
+// 从就绪链表中取出就绪的文件
+static int epoll_collect(epoll_t *ep, epoll_event_t *events, int maxevents) {
+    int count = 0;
+    int size = list_size(&ep->ready);
+    for (int i = 0; i < size && count < maxevents; i++) {
+        list_node_t *node = list_pop(&ep->ready);
+        epitem_t *item = element_entry(epitem_t, rnode, node);
+        item->ready = false;
+
+        wait_queue_t *queue;
+        u32 mask = item->event.events | EPOLLERR | EPOLLHUP;
+        u32 revents = file_poll(item->file, &queue) & mask;
+        if (!revents) {
+            continue;
+        }
+
+        events[count].events = revents;
+        events[count].data = item->event.data;
+        count++;
+
+        // 水平触发时仍然就绪，下次等待时再检查
+        if (!(item->event.events & EPOLLET)) {
+            item->ready = true;
+            list_pushback(&ep->ready, &item->rnode);
+        }
+    }
+    return count;
+}
+
+int sys_epoll_wait(fd_t epfd, epoll_event_t *events, int maxevents,
+                   int timeout) {
+    epoll_t *ep = get_epoll(epfd);
+    if (!ep || maxevents <= 0) {
+        return EOF;
+    }
+
+    task_t *task = running_task();
+    u32 deadline = jiffies + div_round_up(MAX(timeout, 0), jiffy);
+
+    wait_entry_t entry;
+    wait_add(&ep->wait, &entry);
+
+    int count = 0;
+    while (true) {
+        count = epoll_collect(ep, events, maxevents);
+        if (count || !timeout) {
+            break;
+        }
+
+        if (timeout < 0) {
+            task_block(task, NULL, TASK_BLOCKED);
+            continue;
+        }
+
+        if (jiffies >= deadline) {
+            break;
+        }
+        task_sleep((deadline - jiffies) * jiffy);
+    }
+
+    wait_remove(&entry);
+    return count;
+}
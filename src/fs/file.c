@@ -1,7 +1,13 @@
+#include <oak/arena.h>
 #include <oak/assert.h>
+#include <oak/buffer.h>
 #include <oak/device.h>
+#include <oak/fifo.h>
 #include <oak/fs.h>
+#include <oak/poll.h>
 #include <oak/stat.h>
+#include <oak/stdlib.h>
+#include <oak/string.h>
 #include <oak/syscall.h>
 #include <oak/task.h>
 #include <oak/types.h>
@@ -80,42 +86,86 @@ void sys_close(fd_t fd) {
     task_put_fd(task, fd);
 }
 
+// 文件标记对应的设备读写标记
+static int file_devflags(file_t *file) {
+    return (file->flags & O_NONBLOCK) ? DEV_NONBLOCK : 0;
+}
+
+static int minix_file_read(file_t *file, char *buf, int count,
+                           off_t *offset) {
+    int len = 0;
+    inode_t *inode = file->inode;
+    if (ISCHR(inode->desc->mode)) {
+        assert(inode->desc->zone[0]);
+        len = device_read(inode->desc->zone[0], buf, count, 0,
+                          file_devflags(file));
+        return len;
+    } else if (ISBLK(inode->desc->mode)) {
+        len = blkdev_read(file, buf, count, offset);
+        return len;
+    } else {
+        len = inode_read(inode, buf, count, *offset);
+    }
+
+    if (len != EOF) {
+        *offset += len;
+    }
+    return len;
+}
+
+int file_read(file_t *file, char *buf, int count, off_t *offset) {
+    file_op_t *fop = file->inode->fop;
+    if (!fop->read) {
+        return EOF;
+    }
+    return fop->read(file, buf, count, offset);
+}
+
 int sys_read(fd_t fd, char *buf, int count) {
     task_t *task = running_task();
     file_t *file = task->files[fd];
     assert(file);
     assert(count > 0);
-    int len = 0;
 
     if ((file->flags & O_ACCMODE) == O_WRONLY) {
         return EOF;
     }
 
+    return file_read(file, buf, count, &file->offset);
+}
+
+static int minix_file_write(file_t *file, char *buf, int count,
+                            off_t *offset) {
+    int len = 0;
     inode_t *inode = file->inode;
-    if (inode->pipe) {
-        len = pipe_read(inode, buf, count);
-        return len;
-    } else if (ISCHR(inode->desc->mode)) {
+    if (ISCHR(inode->desc->mode)) {
         assert(inode->desc->zone[0]);
-        len = device_read(inode->desc->zone[0], buf, count, 0, 0);
+        device_t *device = device_get(inode->desc->zone[0]);
+        len = device_write(inode->desc->zone[0], buf, count, 0,
+                           file_devflags(file));
         return len;
     } else if (ISBLK(inode->desc->mode)) {
-        assert(inode->desc->zone[0]);
-        device_t *device = device_get(inode->desc->zone[0]);
-        assert(file->offset % BLOCK_SIZE == 0);
-        assert(count % BLOCK_SIZE == 0);
-        len = device_read(inode->desc->zone[0], buf, count / BLOCK_SIZE,
-                          file->offset / BLOCK_SIZE, 0);
+        len = blkdev_write(file, buf, count, offset);
+        return len;
     } else {
-        len = inode_read(inode, buf, count, file->offset);
+        len = inode_write(inode, buf, count, *offset);
     }
 
     if (len != EOF) {
-        file->offset += len;
+        *offset += len;
     }
+
     return len;
 }
 
+int file_write(file_t *file, char *buf, int count, off_t *offset) {
+    file_op_t *fop = file->inode->fop;
+    if (!fop->write) {
+        return EOF;
+    }
+    return fop->write(file, buf, count, offset);
+}
+
 int sys_write(fd_t fd, char *buf, int count) {
     task_t *task = running_task();
     file_t *file = task->files[fd];
@@ -126,34 +176,237 @@ int sys_write(fd_t fd, char *buf, int count) {
         return EOF;
     }
 
-    int len = 0;
+    return file_write(file, buf, count, &file->offset);
+}
+
+// 取得 fd 对应的文件，并检查访问模式
+file_t *fd_file(fd_t fd, int mode) {
+    task_t *task = running_task();
+    if (fd >= TASK_FILE_NR || !task->files[fd]) {
+        return NULL;
+    }
+    file_t *file = task->files[fd];
+    if ((file->flags & O_ACCMODE) == mode) {
+        return NULL;
+    }
+    return file;
+}
+
+int sys_pread(fd_t fd, char *buf, int count, off_t offset) {
+    file_t *file = fd_file(fd, O_WRONLY);
+    if (!file || count <= 0) {
+        return EOF;
+    }
+    return file_read(file, buf, count, &offset);
+}
+
+int sys_pwrite(fd_t fd, char *buf, int count, off_t offset) {
+    file_t *file = fd_file(fd, O_RDONLY);
+    if (!file || count <= 0) {
+        return EOF;
+    }
+    return file_write(file, buf, count, &offset);
+}
+
+int sys_readv(fd_t fd, iovec_t *iov, int iovcnt) {
+    file_t *file = fd_file(fd, O_WRONLY);
+    if (!file || iovcnt <= 0) {
+        return EOF;
+    }
+
+    // 普通文件一次遍历文件块缓冲
     inode_t *inode = file->inode;
-    assert(inode);
-    if (inode->pipe) {
-        len = pipe_write(inode, buf, count);
-        return len;
-    } else if (ISCHR(inode->desc->mode)) {
-        assert(inode->desc->zone[0]);
-        device_t *device = device_get(inode->desc->zone[0]);
-        len = device_write(inode->desc->zone[0], buf, count, 0, 0);
+    if (inode->fop == &minix_file_op && ISFILE(inode->desc->mode)) {
+        int len = inode_readv(inode, iov, iovcnt, file->offset);
+        if (len != EOF) {
+            file->offset += len;
+        }
         return len;
-    } else if (ISBLK(inode->desc->mode)) {
-        assert(inode->desc->zone[0]);
-        device_t *device = device_get(inode->desc->zone[0]);
-        assert(file->offset % BLOCK_SIZE == 0);
-        assert(count % BLOCK_SIZE == 0);
-        len = device_write(inode->desc->zone[0], buf, count / BLOCK_SIZE,
-                           file->offset / BLOCK_SIZE, 0);
+    }
+
+    int nr = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        if (!iov[i].iov_len) {
+            continue;
+        }
+        int len = file_read(file, iov[i].iov_base, iov[i].iov_len,
+                            &file->offset);
+        if (len == EOF) {
+            break;
+        }
+        nr += len;
+        if (len < iov[i].iov_len) {
+            break;
+        }
+    }
+    return nr ? nr : EOF;
+}
+
+int sys_writev(fd_t fd, iovec_t *iov, int iovcnt) {
+    file_t *file = fd_file(fd, O_RDONLY);
+    if (!file || iovcnt <= 0) {
+        return EOF;
+    }
+
+    // 普通文件的各个缓冲合并写入文件块缓冲
+    inode_t *inode = file->inode;
+    if (inode->fop == &minix_file_op && ISFILE(inode->desc->mode)) {
+        int len = inode_writev(inode, iov, iovcnt, file->offset);
+        if (len != EOF) {
+            file->offset += len;
+        }
         return len;
-    } else {
-        len = inode_write(inode, buf, count, file->offset);
     }
 
-    if (len != EOF) {
-        file->offset += len;
+    int nr = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        if (!iov[i].iov_len) {
+            continue;
+        }
+        int len = file_write(file, iov[i].iov_base, iov[i].iov_len,
+                             &file->offset);
+        if (len == EOF) {
+            break;
+        }
+        nr += len;
+        if (len < iov[i].iov_len) {
+            break;
+        }
     }
+    return nr ? nr : EOF;
+}
 
-    return len;
+int sys_fcntl(fd_t fd, int cmd, int arg) {
+    task_t *task = running_task();
+    if (fd >= TASK_FILE_NR || !task->files[fd]) {
+        return EOF;
+    }
+
+    file_t *file = task->files[fd];
+    inode_t *inode = file->inode;
+    int mask = O_APPEND | O_NONBLOCK | O_DIRECT;
+    switch (cmd) {
+    case F_GETFL:
+        return file->flags;
+    case F_SETFL:
+        file->flags = (file->flags & ~mask) | (arg & mask);
+        return 0;
+    case F_GETPIPE_SZ:
+        if (!inode->pipe) {
+            return EOF;
+        }
+        return ((fifo_t *)inode->desc)->length;
+    case F_SETPIPE_SZ:
+        if (!inode->pipe) {
+            return EOF;
+        }
+        return pipe_resize(inode, arg);
+    default:
+        return EOF;
+    }
+}
+
+// 将文件 inode 从 offset 处开始的 count 个字节写入文件 out
+// 文件块缓冲直接写入管道或字符设备，不经过用户空间
+static int file_splice(file_t *out, off_t *out_offset, inode_t *inode,
+                       off_t *offset, int count) {
+    if (inode->fop != &minix_file_op || !ISFILE(inode->desc->mode)) {
+        return EOF;
+    }
+
+    if (*offset >= inode->desc->size) {
+        return EOF;
+    }
+
+    u32 begin = *offset;
+    u32 left = MIN(count, inode->desc->size - *offset);
+    while (left) {
+        buffer_t *bf = inode_buffer(inode, *offset / BLOCK_SIZE);
+        char *data = bf ? bf->data : hole_block;
+
+        u32 start = *offset % BLOCK_SIZE;
+        u32 chars = MIN(BLOCK_SIZE - start, left);
+
+        int len = file_write(out, data + start, chars, out_offset);
+        brelse(bf);
+
+        if (len <= 0) {
+            break;
+        }
+        *offset += len;
+        left -= len;
+
+        if (len < chars) {
+            break;
+        }
+    }
+
+    inode_access(inode);
+
+    if (*offset == begin) {
+        return EOF;
+    }
+    return *offset - begin;
+}
+
+// 通过文件操作读入内核缓冲，再写入文件 out，用于不是 minix 普通文件的输入
+static int file_copy(file_t *out, off_t *out_offset, file_t *in,
+                     off_t *offset, int count) {
+    count = MIN(count, BLOCK_SIZE);
+    char *buf = kmalloc(count);
+
+    int len = file_read(in, buf, count, offset);
+    if (len > 0) {
+        int chars = file_write(out, buf, len, out_offset);
+        // 输入的偏移只前进实际写出的数量，未写出的部分下次重新读取
+        *offset -= len - MAX(chars, 0);
+        len = chars;
+    }
+
+    kfree(buf);
+    return len > 0 ? len : EOF;
+}
+
+int sys_sendfile(fd_t out_fd, fd_t in_fd, off_t *offset, int count) {
+    file_t *in = fd_file(in_fd, O_WRONLY);
+    file_t *out = fd_file(out_fd, O_RDONLY);
+    // 输入与输出是同一文件时，拷贝的源与目的重叠
+    if (!in || !out || in->inode == out->inode || count <= 0) {
+        return EOF;
+    }
+
+    // 指定偏移时不改变输入文件的偏移
+    if (!offset) {
+        offset = &in->offset;
+    }
+
+    // 只有 minix 普通文件有块缓冲，设备文件、目录、管道等经过内核缓冲拷贝
+    inode_t *inode = in->inode;
+    if (inode->fop != &minix_file_op || !ISFILE(inode->desc->mode)) {
+        return file_copy(out, &out->offset, in, offset, count);
+    }
+    return file_splice(out, &out->offset, inode, offset, count);
+}
+
+int sys_splice(fd_t in_fd, off_t *in_offset, fd_t out_fd, off_t *out_offset,
+               int count, int flags) {
+    file_t *in = fd_file(in_fd, O_WRONLY);
+    file_t *out = fd_file(out_fd, O_RDONLY);
+    if (!in || !out || in->inode == out->inode || count <= 0) {
+        return EOF;
+    }
+
+    if (!in_offset) {
+        in_offset = &in->offset;
+    }
+    if (!out_offset) {
+        out_offset = &out->offset;
+    }
+
+    if (in->inode->pipe) {
+        return pipe_splice(in->inode, out, out_offset, count);
+    }
+    return file_splice(out, out_offset, in->inode, in_offset, count);
 }
 
 int sys_lseek(fd_t fd, off_t offset, whence_t whence) {
@@ -189,6 +442,106 @@ int sys_readdir(fd_t fd, dirent_t *dir, u32 count) {
     return sys_read(fd, (char *)dir, sizeof(dirent_t));
 }
 
+// 目录项的文件类型，需要读取 inode
+static u8 entry_type(inode_t *dir, dentry_t *entry) {
+    inode_t *inode = iget(dir->dev, entry->nr);
+    u8 type = (inode->desc->mode & IFMT) >> 12;
+    iput(inode);
+    return type;
+}
+
+static int minix_getdents(file_t *file, getdent_t *dirp, u32 count) {
+    inode_t *dir = file->inode;
+    if (!ISDIR(dir->desc->mode)) {
+        return EOF;
+    }
+
+    u32 entries = dir->desc->size / sizeof(dentry_t);
+    char *ptr = (char *)dirp;
+    char *end = ptr + count;
+
+    buffer_t *buf = NULL;
+    idx_t block = EOF;
+    idx_t i = file->offset / sizeof(dentry_t);
+    for (; i < entries; i++) {
+        if (!buf || block != i / BLOCK_DENTRIES) {
+            brelse(buf);
+            block = i / BLOCK_DENTRIES;
+            idx_t nr = bmap(dir, block, false);
+            assert(nr);
+            buf = bread(dir->dev, nr);
+        }
+
+        dentry_t *entry = &((dentry_t *)buf->data)[i % BLOCK_DENTRIES];
+        if (!entry->nr) {
+            continue;
+        }
+
+        u32 namelen = 0;
+        while (namelen < NAME_LEN && entry->name[namelen]) {
+            namelen++;
+        }
+        u32 reclen = (sizeof(getdent_t) + namelen + 1 + 3) & ~3;
+        if (ptr + reclen > end) {
+            break;
+        }
+
+        getdent_t *dent = (getdent_t *)ptr;
+        dent->nr = entry->nr;
+        dent->reclen = reclen;
+        dent->type = entry_type(dir, entry);
+        dent->namelen = namelen;
+        memcpy(dent->name, entry->name, namelen);
+        dent->name[namelen] = '\0';
+        ptr += reclen;
+    }
+    brelse(buf);
+
+    // 缓冲放不下一个目录项
+    if (ptr == (char *)dirp && i < entries) {
+        return EOF;
+    }
+
+    file->offset = i * sizeof(dentry_t);
+    return ptr - (char *)dirp;
+}
+
+/*
+ *  @brief  读取目录 fd 中尽可能多的目录项到 dirp
+ *  @param  count  dirp 的字节数
+ *  @return  写入的字节数，目录读完返回 0
+ */
+int sys_getdents(fd_t fd, getdent_t *dirp, u32 count) {
+    file_t *file = fd_file(fd, O_WRONLY);
+    if (!file || !file->inode->fop->getdents) {
+        return EOF;
+    }
+    return file->inode->fop->getdents(file, dirp, count);
+}
+
+// 字符设备通过 ioctl 查询就绪事件，普通文件和块设备文件总是就绪
+static int minix_file_poll(file_t *file, wait_queue_t **queue) {
+    inode_t *inode = file->inode;
+    if (!ISCHR(inode->desc->mode)) {
+        return POLLIN | POLLOUT;
+    }
+
+    int events = device_ioctl(inode->desc->zone[0], DEV_CMD_POLL, queue, 0);
+    // 设备不支持查询，总是就绪
+    if (events == EOF) {
+        *queue = NULL;
+        return POLLIN | POLLOUT;
+    }
+    return events;
+}
+
+file_op_t minix_file_op = {
+    .read = minix_file_read,
+    .write = minix_file_write,
+    .poll = minix_file_poll,
+    .getdents = minix_getdents,
+};
+
 static int dupfd(fd_t fd, fd_t arg) {
     task_t *task = running_task();
     if (fd >= TASK_FILE_NR || !task->files[fd])
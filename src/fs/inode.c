@@ -2,19 +2,47 @@
 #include <oak/assert.h>
 #include <oak/buffer.h>
 #include <oak/debug.h>
+#include <oak/epoll.h>
 #include <oak/fifo.h>
 #include <oak/fs.h>
 #include <oak/memory.h>
+#include <oak/proc.h>
+#include <oak/slab.h>
 #include <oak/stat.h>
 #include <oak/stdlib.h>
 #include <oak/string.h>
 #include <oak/syscall.h>
 #include <oak/task.h>
 #include <oak/types.h>
+#include <oak/uring.h>
+
+extern time_t sys_time();
 
 #define INODE_NR 64
 
+// 单个 inode 延迟分配块数量的上限，超过则写回
+#define DELAY_BLOCKS 64
+
+// 所有 inode 延迟分配块数量的上限，为高速缓冲的 1/4
+#define DELAY_TOTAL (kernel_buffer_size / BLOCK_SIZE / 4)
+
 static inode_t inode_table[INODE_NR];
+static kmem_cache_t *fifo_cache; // 管道的缓冲队列
+static u32 delay_total;          // 所有 inode 延迟分配的块数量
+
+char hole_block[BLOCK_SIZE];
+
+// 被截断文件的块索引，较大的文件交给内核线程释放
+typedef struct truncate_t {
+    dev_t dev;        // 设备号
+    u16 zone[9];      // 从 inode 中摘下的块索引
+    list_node_t node; // truncate_list 结点
+} truncate_t;
+
+static list_t truncate_list;        // 等待释放的块索引
+static truncate_t *truncate_active; // 正在释放的块索引
+static task_t *truncate_waiter;     // 等待任务的内核线程
+static wait_queue_t truncate_done;  // 等待当前任务释放完成的进程
 
 // 申请一个 inode
 static inode_t *get_free_inode() {
@@ -33,6 +61,9 @@ static void put_free_inode(inode_t *inode) {
     assert(inode != inode_table);
     assert(inode->count == 0);
     inode->dev = EOF;
+    inode->op = NULL;
+    inode->fop = NULL;
+    inode->data = NULL;
 }
 
 // 获取根 inode
@@ -43,13 +74,15 @@ inode_t *get_pipe_inode() {
     // 区别于 EOF 这里是无效的设备，但是被占用了
     inode->dev = -2;
     // 申请内存，表示缓冲队列
-    inode->desc = (inode_desc_t *)kmalloc(sizeof(fifo_t));
+    inode->desc = (inode_desc_t *)kmem_cache_alloc(fifo_cache);
     // 管道缓冲区一页内存
     inode->buf = (void *)alloc_kpage(1);
     // 两个文件
     inode->count = 2;
     // 管道标志
     inode->pipe = true;
+    inode->pipe_busy = 0;
+    inode->fop = &pipe_fop;
     // 初始化输入输出设备
     fifo_init((fifo_t *)inode->desc, (char *)inode->buf, PAGE_SIZE);
     return inode;
@@ -63,14 +96,64 @@ void put_pipe_inode(inode_t *inode) {
         return;
     inode->pipe = false;
 
+    // 释放缓冲区，缓冲大小可能被 fcntl 修改
+    fifo_t *fifo = (fifo_t *)inode->desc;
+    free_kpage((u32)inode->buf, fifo->length / PAGE_SIZE);
     // 释放描述符 fifo
-    kfree(inode->desc);
-    // 释放缓冲区
-    free_kpage((u32)inode->buf, 1);
+    kmem_cache_free(fifo_cache, inode->desc);
     // 释放 inode
     put_free_inode(inode);
 }
 
+inode_t *get_epoll_inode() {
+    inode_t *inode = get_free_inode();
+    // 与管道一样是无效的设备
+    inode->dev = -2;
+    inode->desc = (inode_desc_t *)kmalloc(sizeof(epoll_t));
+    inode->buf = NULL;
+    inode->count = 1;
+    inode->epoll = true;
+    inode->fop = &epoll_fop;
+    epoll_init((epoll_t *)inode->desc);
+    return inode;
+}
+
+void put_epoll_inode(inode_t *inode) {
+    inode->count--;
+    if (inode->count)
+        return;
+    inode->epoll = false;
+
+    // 释放关注的文件
+    epoll_release((epoll_t *)inode->desc);
+    kfree(inode->desc);
+    put_free_inode(inode);
+}
+
+inode_t *get_uring_inode(uring_params_t *params) {
+    inode_t *inode = get_free_inode();
+    inode->dev = -2;
+    inode->desc = (inode_desc_t *)kmalloc(sizeof(uring_t));
+    inode->buf = NULL;
+    inode->count = 1;
+    inode->uring = true;
+    inode->fop = &uring_fop;
+    uring_init(inode, params);
+    return inode;
+}
+
+void put_uring_inode(inode_t *inode) {
+    inode->count--;
+    if (inode->count)
+        return;
+    inode->uring = false;
+
+    // 释放共享队列的页
+    uring_release(inode);
+    kfree(inode->desc);
+    put_free_inode(inode);
+}
+
 // 计算 inode nr 对应的块号
 static inline idx_t inode_block(super_block_t *sb, idx_t nr) {
     // inode 编号 从 1 开始
@@ -112,7 +195,7 @@ inode_t *iget(dev_t dev, idx_t nr) {
     // inode 已读入内存
     if (inode) {
         inode->count++;
-        inode->atime = time();
+        inode_access(inode);
 
         return fit_inode(inode);
     }
@@ -120,8 +203,6 @@ inode_t *iget(dev_t dev, idx_t nr) {
     super_block_t *sb = get_super(dev);
     assert(sb);
 
-    assert(nr <= sb->desc->inodes);
-
     inode = get_free_inode();
     inode->dev = dev;
     inode->nr = nr;
@@ -130,6 +211,15 @@ inode_t *iget(dev_t dev, idx_t nr) {
     // 加入超级块 inode 链表
     list_push(&sb->inode_list, &inode->node);
 
+    // 由文件系统读取 inode
+    sb->op->read_inode(inode);
+    return inode;
+}
+
+void minix_read_inode(inode_t *inode) {
+    super_block_t *sb = get_super(inode->dev);
+    assert(inode->nr <= sb->desc->inodes);
+
     // 获取对应块号
     idx_t block = inode_block(sb, inode->nr);
     // 读取对应块到高速缓冲
@@ -140,10 +230,13 @@ inode_t *iget(dev_t dev, idx_t nr) {
     // 将缓冲视为一个 inode 描述符数组，获取对应的指针；
     inode->desc = &((inode_desc_t *)buf->data)[(inode->nr - 1) % BLOCK_INODES];
 
+    // 磁盘上没有访问时间，从修改时间开始按挂载标记更新
     inode->ctime = inode->desc->mtime;
-    inode->atime = time();
+    inode->atime = inode->desc->mtime;
+    inode_access(inode);
 
-    return inode;
+    inode->op = &minix_inode_op;
+    inode->fop = &minix_file_op;
 }
 
 inode_t *new_inode(dev_t dev, idx_t nr) {
@@ -155,13 +248,230 @@ inode_t *new_inode(dev_t dev, idx_t nr) {
     inode->desc->mode = 0777 & (~task->umask);
     inode->desc->uid = task->uid;
     inode->desc->size = 0;
-    inode->desc->mtime = inode->atime = time();
+    inode->desc->mtime = inode->atime = sys_time();
     inode->desc->gid = task->gid;
     inode->desc->nlinks = 1;
 
     return inode;
 }
 
+// 查找 inode 第 block 块的延迟分配缓冲
+static buffer_t *delay_find(inode_t *inode, idx_t block) {
+    list_t *list = &inode->delay_list;
+    for (list_node_t *node = list->head.next; node != &list->tail;
+         node = node->next) {
+        buffer_t *bf = element_entry(buffer_t, dnode, node);
+        if (bf->block == block) {
+            bf->count++;
+            return bf;
+        }
+    }
+    return NULL;
+}
+
+// inode 是否有文件块在 [start, start + count) 中的延迟分配缓冲
+static bool delay_range(inode_t *inode, idx_t start, u32 count) {
+    list_t *list = &inode->delay_list;
+    for (list_node_t *node = list->head.next; node != &list->tail;
+         node = node->next) {
+        buffer_t *bf = element_entry(buffer_t, dnode, node);
+        if (bf->block >= start && bf->block < start + count) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 写回第 block 块时需要新分配的间接块数量，已为其他延迟块预留的不再计算
+static u32 delay_meta(inode_t *inode, idx_t block) {
+    u16 *zone = inode->desc->zone;
+    if (block < DIRECT_BLOCK) {
+        return 0;
+    }
+
+    block -= DIRECT_BLOCK;
+    if (block < INDIRECT1_BLOCK) {
+        if (zone[DIRECT_BLOCK] ||
+            delay_range(inode, DIRECT_BLOCK, INDIRECT1_BLOCK)) {
+            return 0;
+        }
+        return 1;
+    }
+
+    // 二级间接块，以及其中第 index 项指向的一级间接块
+    block -= INDIRECT1_BLOCK;
+    idx_t first = DIRECT_BLOCK + INDIRECT1_BLOCK;
+    u32 index = block / BLOCK_INDEXES;
+    u32 meta = 0;
+
+    if (zone[DIRECT_BLOCK + 1]) {
+        buffer_t *bf = bread(inode->dev, zone[DIRECT_BLOCK + 1]);
+        u16 nr = ((u16 *)bf->data)[index];
+        brelse(bf);
+        if (nr) {
+            return 0;
+        }
+    } else if (!delay_range(inode, first, INDIRECT2_BLOCK)) {
+        meta++;
+    }
+
+    if (!delay_range(inode, first + index * BLOCK_INDEXES, BLOCK_INDEXES)) {
+        meta++;
+    }
+    return meta;
+}
+
+static int delay_flush(inode_t *inode);
+
+// 延迟分配的块过多时，写回延迟块最多的 inode
+static void delay_balance() {
+    inode_t *victim = NULL;
+    for (size_t i = 0; i < INODE_NR; i++) {
+        inode_t *inode = &inode_table[i];
+        if (inode->dev != EOF && (!victim || inode->delays > victim->delays)) {
+            victim = inode;
+        }
+    }
+    if (victim && victim->delays) {
+        delay_flush(victim);
+    }
+}
+
+// 获取 inode 第 block 块的延迟分配缓冲，不存在则在超级块中预留空间并创建
+// 预留的空间包括写回时需要的间接块
+static buffer_t *delay_get(inode_t *inode, idx_t block) {
+    buffer_t *bf = delay_find(inode, block);
+    if (bf) {
+        return bf;
+    }
+
+    // 避免延迟缓冲占满高速缓冲，写回失败说明磁盘已满
+    if (delay_total >= DELAY_TOTAL) {
+        delay_balance();
+        if (delay_total >= DELAY_TOTAL) {
+            return NULL;
+        }
+    }
+
+    super_block_t *sb = get_super(inode->dev);
+    assert(sb);
+    u32 meta = delay_meta(inode, block);
+    if (sb->zreserved + meta + 1 > sb->zfree) {
+        return NULL;
+    }
+    sb->zreserved += meta + 1;
+    inode->dmeta += meta;
+
+    bf = getblk_delay(inode->dev);
+    bf->block = block;
+    list_insert_sort(&inode->delay_list, &bf->dnode,
+                     element_node_offset(buffer_t, dnode, block));
+    inode->delays++;
+    delay_total++;
+
+    // 链表持有一个引用，调用者持有一个引用
+    bf->count++;
+    return bf;
+}
+
+// 为延迟分配的块分配磁盘块并写回，文件块连续的缓冲分配连续的磁盘块
+// 磁盘空间不足时返回 EOF，未写回的块留在链表中
+static int delay_flush(inode_t *inode) {
+    super_block_t *sb = get_super(inode->dev);
+    list_t *list = &inode->delay_list;
+
+    while (!list_empty(list)) {
+        buffer_t *first = element_entry(buffer_t, dnode, list->head.next);
+
+        // 统计文件块号连续的缓冲数量
+        u32 count = 1;
+        for (list_node_t *node = first->dnode.next; node != &list->tail;
+             node = node->next) {
+            buffer_t *bf = element_entry(buffer_t, dnode, node);
+            if (bf->block != first->block + count) {
+                break;
+            }
+            count++;
+        }
+
+        idx_t zone = balloc_run(inode->dev, &count);
+        if (zone == EOF) {
+            goto nospace;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            buffer_t *bf = element_entry(buffer_t, dnode, list->head.next);
+            if (bmap_assign(inode, bf->block, zone + i) == EOF) {
+                // 间接块分配失败，归还剩余的块
+                for (; i < count; i++) {
+                    bclear(inode->dev, zone + i);
+                }
+                bsync(inode->dev);
+                goto nospace;
+            }
+            list_pop(list);
+            bassign(bf, zone + i);
+            sb->zreserved--;
+            inode->delays--;
+            delay_total--;
+            // 释放链表持有的引用，脏缓冲在此写回
+            brelse(bf);
+        }
+    }
+    assert(inode->delays == 0);
+
+    // 间接块已经分配，释放为其预留的空间
+    sb->zreserved -= inode->dmeta;
+    inode->dmeta = 0;
+    return 0;
+
+nospace:
+    DEBUGK("no space for delayed blocks of inode %d\n", inode->nr);
+    return EOF;
+}
+
+// 丢弃 inode 所有延迟分配的块，不产生任何位图操作
+static void delay_discard(inode_t *inode) {
+    super_block_t *sb = get_super(inode->dev);
+    list_t *list = &inode->delay_list;
+
+    while (!list_empty(list)) {
+        buffer_t *bf = element_entry(buffer_t, dnode, list_pop(list));
+        bdiscard(bf);
+        sb->zreserved--;
+        inode->delays--;
+        delay_total--;
+    }
+    assert(inode->delays == 0);
+
+    sb->zreserved -= inode->dmeta;
+    inode->dmeta = 0;
+}
+
+int inode_sync(inode_t *inode) {
+    int ret = delay_flush(inode);
+    if (inode->buf->dirty) {
+        bwrite(inode->buf);
+    }
+    bsync(inode->dev);
+    return ret;
+}
+
+// 最后一个引用时写回延迟分配的块，inode 修改过则写回
+// 磁盘空间不足时丢弃未写回的块，文件大小不变，这部分读出为 0
+void minix_write_inode(inode_t *inode) {
+    if (inode->count == 1 && delay_flush(inode) == EOF) {
+        delay_discard(inode);
+    }
+
+    if (inode->buf->dirty) {
+        bwrite(inode->buf);
+    }
+}
+
+// 释放 inode 对应的缓冲
+void minix_put_inode(inode_t *inode) { brelse(inode->buf); }
+
 // 释放 inode
 void iput(inode_t *inode) {
     if (!inode) {
@@ -172,8 +482,23 @@ void iput(inode_t *inode) {
         return put_pipe_inode(inode);
     }
 
-    if (inode->buf->dirty) {
-        bwrite(inode->buf);
+    if (inode->epoll) {
+        return put_epoll_inode(inode);
+    }
+
+    if (inode->uring) {
+        return put_uring_inode(inode);
+    }
+
+    super_block_t *sb = get_super(inode->dev);
+
+    // 最后一个引用，释放页缓存
+    if (inode->count == 1) {
+        page_cache_drop(inode);
+    }
+
+    if (sb->op->write_inode) {
+        sb->op->write_inode(inode);
     }
 
     inode->count--;
@@ -182,8 +507,9 @@ void iput(inode_t *inode) {
         return;
     }
 
-    // 释放 inode 对应的缓冲
-    brelse(inode->buf);
+    if (sb->op->put_inode) {
+        sb->op->put_inode(inode);
+    }
 
     // 从超级块链表中移除
     list_remove(&inode->node);
@@ -197,13 +523,114 @@ void inode_init() {
         inode_t *inode = &inode_table[i];
         inode->dev = EOF;
         inode->pipe = false;
-        inode->rxwaiter = NULL;
-        inode->txwaiter = NULL;
+        inode->epoll = false;
+        inode->uring = false;
+        wait_init(&inode->wait);
+        list_init(&inode->delay_list);
+        inode->delays = 0;
+        inode->dmeta = 0;
     }
+    list_init(&truncate_list);
+    wait_init(&truncate_done);
+    fifo_cache = kmem_cache_create("fifo_t", sizeof(fifo_t), NULL);
+}
+
+void inode_show(proc_buf_t *pb) {
+    u32 used = 0;
+    for (size_t i = 0; i < INODE_NR; i++) {
+        if (inode_table[i].dev != EOF) {
+            used++;
+        }
+    }
+    proc_printf(pb, "inodes    %u/%u\n", used, INODE_NR);
+    proc_printf(pb, "truncate  %u\n", list_size(&truncate_list));
+
+    proc_printf(pb, "dev  nr    count kind  mode   size     delays\n");
+    for (size_t i = 0; i < INODE_NR; i++) {
+        inode_t *inode = &inode_table[i];
+        if (inode->dev == EOF) {
+            continue;
+        }
+
+        // 匿名 inode 的 desc 不是 inode 描述符
+        char *kind = inode->pipe    ? "pipe"
+                     : inode->epoll ? "epoll"
+                     : inode->uring ? "uring"
+                                    : NULL;
+        if (kind) {
+            proc_printf(pb, "%-4d %-5d %-5u %s\n", inode->dev, inode->nr,
+                        inode->count, kind);
+            continue;
+        }
+        proc_printf(pb, "%-4d %-5d %-5u file  %-6o %-8u %u\n", inode->dev,
+                    inode->nr, inode->count, inode->desc->mode,
+                    inode->desc->size, inode->delays);
+    }
+}
+
+// 读取文件第 block 块的缓冲，尚未分配的块在延迟分配链表中，都没有返回 NULL
+buffer_t *inode_buffer(inode_t *inode, idx_t block) {
+    idx_t nr = bmap(inode, block, false);
+    if (nr) {
+        return bread(inode->dev, nr);
+    }
+    return delay_find(inode, block);
+}
+
+// iov 数组的总长度
+static u32 iov_length(iovec_t *iov, int iovcnt) {
+    u32 len = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        len += iov[i].iov_len;
+    }
+    return len;
+}
+
+// 在文件块 ptr 与 iov 数组之间拷贝 chars 个字节，pos 为当前 iov 中的偏移
+static void iov_copy(iovec_t **iov, u32 *pos, char *ptr, u32 chars,
+                     bool write) {
+    while (chars) {
+        iovec_t *vec = *iov;
+        u32 count = MIN(vec->iov_len - *pos, chars);
+        char *base = (char *)vec->iov_base + *pos;
+        if (write) {
+            memcpy(ptr, base, count);
+        } else {
+            memcpy(base, ptr, count);
+        }
+        ptr += count;
+        chars -= count;
+        *pos += count;
+        if (*pos == vec->iov_len) {
+            (*iov)++;
+            *pos = 0;
+        }
+    }
+}
+
+void inode_access(inode_t *inode) {
+    super_block_t *sb = get_super(inode->dev);
+    if (sb->flags & MS_NOATIME) {
+        return;
+    }
+
+    time_t now = sys_time();
+    // relatime 只在访问时间不晚于修改时间，或者已经过去一天时更新
+    if ((sb->flags & MS_RELATIME) && inode->atime > inode->desc->mtime &&
+        inode->atime > inode->ctime && now - inode->atime < RELATIME_INTERVAL) {
+        return;
+    }
+    inode->atime = now;
 }
 
 // 从 inode 的 offset 处，读 len 个字节到 buf
 int inode_read(inode_t *inode, char *buf, u32 len, off_t offset) {
+    iovec_t iov = {buf, len};
+    return inode_readv(inode, &iov, 1, offset);
+}
+
+// 从 inode 的 offset 处，依次读入 iov 中的各个缓冲
+int inode_readv(inode_t *inode, iovec_t *iov, int iovcnt, off_t offset) {
     assert(ISFILE(inode->desc->mode) || ISDIR(inode->desc->mode));
 
     // 如果偏移量超过文件大小，返回 EOF
@@ -214,15 +641,16 @@ int inode_read(inode_t *inode, char *buf, u32 len, off_t offset) {
     // 开始读取的位置
     u32 begin = offset;
 
+    // 当前 iov 中的偏移
+    u32 pos = 0;
+
     // 剩余字节数
-    u32 left = MIN(len, inode->desc->size - offset);
+    u32 left = MIN(iov_length(iov, iovcnt), inode->desc->size - offset);
     while (left) {
-        // 找到对应的文件偏移，所在文件块
-        idx_t nr = bmap(inode, offset / BLOCK_SIZE, false);
-        assert(nr);
-
-        // 读取文件块缓冲
-        buffer_t *bf = bread(inode->dev, nr);
+        // 读取文件偏移所在的文件块
+        // 没有磁盘块的部分读出为 0，比如写回失败被丢弃的块
+        buffer_t *bf = inode_buffer(inode, offset / BLOCK_SIZE);
+        char *data = bf ? bf->data : hole_block;
 
         // 文件块中的偏移量
         u32 start = offset % BLOCK_SIZE;
@@ -234,21 +662,15 @@ int inode_read(inode_t *inode, char *buf, u32 len, off_t offset) {
         offset += chars;
         left -= chars;
 
-        // 文件块中的指针
-        char *ptr = bf->data + start;
-
-        // 拷贝内容
-        memcpy(buf, ptr, chars);
-
-        // 更新缓存位置
-        buf += chars;
+        // 拷贝内容，一个文件块可能分散到多个缓冲
+        iov_copy(&iov, &pos, data + start, chars, false);
 
         // 释放文件块缓冲
         brelse(bf);
     }
 
     // 更新访问时间
-    inode->atime = time();
+    inode_access(inode);
 
     // 返回读取数量
     return offset - begin;
@@ -256,28 +678,47 @@ int inode_read(inode_t *inode, char *buf, u32 len, off_t offset) {
 
 // 从 inode 的 offset 处，将 buf 的 len 个字节写入磁盘
 int inode_write(inode_t *inode, char *buf, u32 len, off_t offset) {
+    iovec_t iov = {buf, len};
+    return inode_writev(inode, &iov, 1, offset);
+}
+
+// 从 inode 的 offset 处，依次写入 iov 中的各个缓冲
+int inode_writev(inode_t *inode, iovec_t *iov, int iovcnt, off_t offset) {
     // 不允许目录写入目录文件，修改目录有其他的专用方法
     assert(ISFILE(inode->desc->mode));
 
     // 开始的位置
     u32 begin = offset;
+    u32 size = inode->desc->size;
+
+    // 当前 iov 及其中的偏移
+    iovec_t *vec = iov;
+    u32 pos = 0;
 
     // 剩余数量
+    u32 len = iov_length(iov, iovcnt);
     u32 left = len;
 
     while (left) {
-        // 找到文件块，若不存在则创建
-        idx_t nr = bmap(inode, offset / BLOCK_SIZE, true);
-        assert(nr);
+        // 找到文件块，若不存在则延迟分配，写回时再分配磁盘块
+        idx_t nr = bmap(inode, offset / BLOCK_SIZE, false);
 
         // 将读入文件块
-        buffer_t *bf = bread(inode->dev, nr);
+        buffer_t *bf = NULL;
+        if (nr) {
+            bf = bread(inode->dev, nr);
+        } else {
+            bf = delay_get(inode, offset / BLOCK_SIZE);
+        }
+
+        // 磁盘空间不足
+        if (!bf) {
+            break;
+        }
         bf->dirty = true;
 
         // 块中的偏移量
         u32 start = offset % BLOCK_SIZE;
-        // 文件块中的指针
-        char *ptr = bf->data + start;
 
         // 读取的数量
         u32 chars = MIN(BLOCK_SIZE - start, left);
@@ -294,42 +735,109 @@ int inode_write(inode_t *inode, char *buf, u32 len, off_t offset) {
             inode->buf->dirty = true;
         }
 
-        // 拷贝内容
-        memcpy(ptr, buf, chars);
-
-        // 更新缓存偏移
-        buf += chars;
+        // 拷贝内容，多个缓冲的内容合并写入一个文件块
+        iov_copy(&vec, &pos, bf->data + start, chars, true);
 
         // 释放文件块
         brelse(bf);
     }
 
+    // 延迟分配的块过多，写回以免占满高速缓冲
+    if (inode->delays >= DELAY_BLOCKS) {
+        delay_flush(inode);
+    }
+
+    // 同步映射到内存中的页
+    for (u32 done = begin; done < offset; iov++) {
+        u32 chars = MIN(iov->iov_len, offset - done);
+        page_cache_write(inode, iov->iov_base, chars, done);
+        done += chars;
+    }
+
     // 更新修改时间
-    inode->desc->mtime = inode->atime = time();
+    inode->desc->mtime = inode->atime = sys_time();
+    inode->buf->dirty = true;
 
-    // TODO: 写入磁盘 ？
-    bwrite(inode->buf);
+    // lazytime 时文件大小不变的 inode 只修改了时间戳，释放或同步时再写回
+    super_block_t *sb = get_super(inode->dev);
+    if (!(sb->flags & MS_LAZYTIME) || inode->desc->size != size) {
+        bwrite(inode->buf);
+    }
+
+    if (offset == begin && len) {
+        return EOF;
+    }
 
     // 返回写入大小
     return offset - begin;
 }
 
-static void inode_bfree(inode_t *inode, u16 *array, int index, int level) {
+// 释放块，位图在全部释放后统一写回
+static void inode_bfree(dev_t dev, u16 *array, int index, int level) {
     if (!array[index]) {
         return;
     }
 
     if (!level) {
-        bfree(inode->dev, array[index]);
+        bclear(dev, array[index]);
         return;
     }
 
-    buffer_t *buf = bread(inode->dev, array[index]);
+    buffer_t *buf = bread(dev, array[index]);
     for (size_t i = 0; i < BLOCK_INDEXES; i++) {
-        inode_bfree(inode, (u16 *)buf->data, i, level - 1);
+        inode_bfree(dev, (u16 *)buf->data, i, level - 1);
     }
     brelse(buf);
-    bfree(inode->dev, array[index]);
+    bclear(dev, array[index]);
+}
+
+// 释放块索引中的所有块，每个位图块只写一次
+static void zone_free(dev_t dev, u16 *zone) {
+    for (size_t i = 0; i < DIRECT_BLOCK; i++) {
+        inode_bfree(dev, zone, i, 0);
+    }
+    inode_bfree(dev, zone, DIRECT_BLOCK, 1);
+    inode_bfree(dev, zone, DIRECT_BLOCK + 1, 2);
+    bsync(dev);
+}
+
+// 释放被截断文件块的内核线程
+void truncate_thread() {
+    while (true) {
+        if (list_empty(&truncate_list)) {
+            truncate_waiter = running_task();
+            task_block(truncate_waiter, NULL, TASK_BLOCKED);
+            continue;
+        }
+
+        truncate_t *job =
+            element_entry(truncate_t, node, list_popback(&truncate_list));
+        truncate_active = job;
+        zone_free(job->dev, job->zone);
+        truncate_active = NULL;
+        kfree(job);
+        wait_wakeup(&truncate_done);
+    }
+}
+
+// 立即释放设备 dev 上等待释放的块，用于卸载设备
+void truncate_sync(dev_t dev) {
+    list_t *list = &truncate_list;
+    for (list_node_t *node = list->head.next; node != &list->tail;) {
+        truncate_t *job = element_entry(truncate_t, node, node);
+        node = node->next;
+        if (job->dev != dev) {
+            continue;
+        }
+        list_remove(&job->node);
+        zone_free(job->dev, job->zone);
+        kfree(job);
+    }
+
+    // 等待内核线程释放完当前的任务
+    while (truncate_active && truncate_active->dev == dev) {
+        wait_sleep(&truncate_done);
+    }
 }
 
 void inode_truncate(inode_t *inode) {
@@ -337,19 +845,32 @@ void inode_truncate(inode_t *inode) {
         return;
     }
 
-    for (size_t i = 0; i < DIRECT_BLOCK; i++) {
-        inode_bfree(inode, inode->desc->zone, i, 0);
-        inode->desc->zone[i] = 0;
+    // 尚未写回的块直接丢弃
+    delay_discard(inode);
+    // 缓存的页可能仍被映射，清零使其与截断后的文件一致
+    page_cache_zero(inode);
+
+    u16 *zone = inode->desc->zone;
+
+    // 只有直接块的文件直接释放，否则需要读取间接块，交给内核线程
+    if (!zone[DIRECT_BLOCK] && !zone[DIRECT_BLOCK + 1]) {
+        zone_free(inode->dev, zone);
+    } else {
+        truncate_t *job = kmalloc(sizeof(truncate_t));
+        job->dev = inode->dev;
+        memcpy(job->zone, zone, sizeof(job->zone));
+        list_push(&truncate_list, &job->node);
+
+        if (truncate_waiter) {
+            task_unblock(truncate_waiter);
+            truncate_waiter = NULL;
+        }
     }
 
-    inode_bfree(inode, inode->desc->zone, DIRECT_BLOCK, 1);
-    inode->desc->zone[DIRECT_BLOCK] = 0;
-
-    inode_bfree(inode, inode->desc->zone, DIRECT_BLOCK + 1, 2);
-    inode->desc->zone[DIRECT_BLOCK + 1] = 0;
+    memset(zone, 0, sizeof(inode->desc->zone));
 
     inode->desc->size = 0;
     inode->buf->dirty = true;
-    inode->desc->mtime = time();
+    inode->desc->mtime = sys_time();
     bwrite(inode->buf);
 }
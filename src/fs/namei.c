@@ -38,7 +38,7 @@ bool permission(inode_t *inode, u16 mask) {
  *  @param  entry_name  待匹配的项
  *  @param  next  去除指定项后的路径指针
  */
-static bool match_name(const char *path, const char *entry_name, char **next) {
+bool match_name(const char *path, const char *entry_name, char **next) {
     char *lhs = (char *)path;
     char *rhs = (char *)entry_name;
 
@@ -71,6 +71,10 @@ static bool match_name(const char *path, const char *entry_name, char **next) {
  */
 static buffer_t *find_entry(inode_t **dir, const char *name, char **next,
                             dentry_t **result) {
+    // 其他文件系统的目录没有 MINIX 目录项
+    if ((*dir)->op != &minix_inode_op) {
+        return NULL;
+    }
     assert(ISDIR((*dir)->desc->mode));
 
     if (match_name(name, "..", next) && (*dir)->nr == 1) {
@@ -111,6 +115,10 @@ static buffer_t *find_entry(inode_t **dir, const char *name, char **next,
 static buffer_t *add_entry(inode_t *dir, const char *name, dentry_t **result) {
     char *next = NULL;
 
+    if (dir->op != &minix_inode_op) {
+        return NULL;
+    }
+
     buffer_t *buf = find_entry(&dir, name, &next, result);
     if (buf) {
         return buf;
@@ -155,7 +163,41 @@ static buffer_t *add_entry(inode_t *dir, const char *name, dentry_t **result) {
 }
 
 // 根据目录名找到父目录 inode
-inode_t *named(char *pathname, char **next) {
+static inode_t *minix_lookup(inode_t *dir, char *name, char **next) {
+    dentry_t *entry = NULL;
+    buffer_t *buf = find_entry(&dir, name, next, &entry);
+    if (!buf) {
+        return NULL;
+    }
+    inode_t *inode = iget(dir->dev, entry->nr);
+    brelse(buf);
+    return inode;
+}
+
+inode_op_t minix_inode_op = {
+    .lookup = minix_lookup,
+    .truncate = inode_truncate,
+};
+
+// 在目录 dir 中查找路径 name 的第一项，返回对应的 inode
+static inode_t *lookup_entry(inode_t **dir, char *name, char **next) {
+    // 挂载的文件系统根目录的父目录，从挂载点所在的目录查找
+    if (match_name(name, "..", next) && (*dir)->nr == 1) {
+        super_block_t *sb = get_super((*dir)->dev);
+        inode_t *inode = *dir;
+        (*dir) = sb->imount;
+        (*dir)->count++;
+        iput(inode);
+    }
+
+    if (!(*dir)->op || !ISDIR((*dir)->desc->mode)) {
+        return NULL;
+    }
+    return (*dir)->op->lookup(*dir, name, next);
+}
+
+// 相对路径从目录 dir 开始查找
+static inode_t *named_at(inode_t *dir, char *pathname, char **next) {
     inode_t *inode = NULL;
     task_t *task = running_task();
     char *left = pathname;
@@ -165,7 +207,7 @@ inode_t *named(char *pathname, char **next) {
         inode = task->iroot;
         left++;
     } else if (left[0]) {
-        inode = task->ipwd;
+        inode = dir;
     } else {
         return NULL;
     }
@@ -187,19 +229,14 @@ inode_t *named(char *pathname, char **next) {
 
     *next = left;
 
-    dentry_t *entry = NULL;
-    buffer_t *buf = NULL;
-
     while (true) {
-        brelse(buf);
-        buf = find_entry(&inode, left, next, &entry);
-        if (!buf) {
+        inode_t *dir = inode;
+        inode = lookup_entry(&dir, left, next);
+        iput(dir);
+        if (!inode) {
             goto failure;
         }
 
-        dev_t dev = inode->dev;
-        iput(inode);
-        inode = iget(dev, entry->nr);
         if (!ISDIR(inode->desc->mode) || !permission(inode, P_EXEC)) {
             goto failure;
         }
@@ -212,18 +249,20 @@ inode_t *named(char *pathname, char **next) {
     }
 
 success:
-    brelse(buf);
     return inode;
 
 failure:
-    brelse(buf);
     iput(inode);
     return NULL;
 }
 
-inode_t *namei(char *pathname) {
+inode_t *named(char *pathname, char **next) {
+    return named_at(running_task()->ipwd, pathname, next);
+}
+
+inode_t *namei_at(inode_t *dir, char *pathname) {
     char *next = NULL;
-    inode_t *dir = named(pathname, &next);
+    dir = named_at(dir, pathname, &next);
     if (!dir) {
         return NULL;
     }
@@ -232,20 +271,15 @@ inode_t *namei(char *pathname) {
     }
 
     char *name = next;
-    dentry_t *entry = NULL;
-    buffer_t *buf = find_entry(&dir, name, &next, &entry);
-    if (!buf) {
-        iput(dir);
-        return NULL;
-    }
-
-    inode_t *inode = iget(dir->dev, entry->nr);
-
+    inode_t *inode = lookup_entry(&dir, name, &next);
     iput(dir);
-    brelse(buf);
     return inode;
 }
 
+inode_t *namei(char *pathname) {
+    return namei_at(running_task()->ipwd, pathname);
+}
+
 int sys_mkdir(char *pathname, int mode) {
     char *next = NULL;
     buffer_t *ebuf = NULL;
@@ -277,6 +311,9 @@ int sys_mkdir(char *pathname, int mode) {
     }
 
     ebuf = add_entry(dir, name, &entry);
+    if (!ebuf) {
+        goto rollback;
+    }
     ebuf->dirty = true;
     entry->nr = ialloc(dir->dev);
 
@@ -462,6 +499,8 @@ int sys_link(char *oldname, char *newname) {
         goto rollback;
 
     buf = add_entry(dir, name, &entry);
+    if (!buf)
+        goto rollback;
     entry->nr = inode->nr;
     buf->dirty = true;
 
@@ -547,9 +586,8 @@ inode_t *inode_open(char *pathname, int flag, int mode) {
         flag |= O_RDWR;
 
     char *name = next;
-    buf = find_entry(&dir, name, &next, &entry);
-    if (buf) {
-        inode = iget(dir->dev, entry->nr);
+    inode = lookup_entry(&dir, name, &next);
+    if (inode) {
         goto makeup;
     }
 
@@ -560,6 +598,8 @@ inode_t *inode_open(char *pathname, int flag, int mode) {
         goto rollback;
 
     buf = add_entry(dir, name, &entry);
+    if (!buf)
+        goto rollback;
     entry->nr = ialloc(dir->dev);
     inode = new_inode(dir->dev, entry->nr);
 
@@ -579,10 +619,10 @@ makeup:
         goto rollback;
     }
 
-    inode->atime = time();
+    inode_access(inode);
 
-    if (flag & O_TRUNC) {
-        inode_truncate(inode);
+    if ((flag & O_TRUNC) && inode->op->truncate) {
+        inode->op->truncate(inode);
     }
     brelse(buf);
     iput(dir);
@@ -721,6 +761,8 @@ int sys_mknod(char *filename, int mode, int dev) {
         goto rollback;
 
     buf = add_entry(dir, name, &entry);
+    if (!buf)
+        goto rollback;
     buf->dirty = true;
     entry->nr = ialloc(dir->dev);
 
@@ -3,47 +3,147 @@
 #include <oak/device.h>
 #include <oak/fifo.h>
 #include <oak/fs.h>
+#include <oak/memory.h>
+#include <oak/poll.h>
 #include <oak/stat.h>
 #include <oak/stdio.h>
+#include <oak/stdlib.h>
 #include <oak/string.h>
 #include <oak/syscall.h>
 #include <oak/task.h>
 #include <oak/types.h>
 
-int pipe_read(inode_t *inode, char *buf, int count) {
+// 管道缓冲的最大页数
+#define PIPE_MAX_PAGES 4
+
+// 管道为空时等待，读取已有的数据后返回
+// 拷贝到用户空间时可能缺页睡眠，期间不能改变缓冲大小
+int pipe_read(inode_t *inode, char *buf, int count, int flags) {
     fifo_t *fifo = (fifo_t *)inode->desc;
-    int nr = 0;
-    while (nr < count) {
-        if (fifo_empty(fifo)) {
-            assert(inode->rxwaiter == NULL);
-            inode->rxwaiter = running_task();
-            task_block(inode->rxwaiter, NULL, TASK_BLOCKED);
-        }
-        buf[nr++] = fifo_get(fifo);
-        if (inode->txwaiter) {
-            task_unblock(inode->txwaiter);
-            inode->txwaiter = NULL;
+    while (fifo_empty(fifo)) {
+        if (flags & O_NONBLOCK) {
+            return EOF;
         }
+        wait_sleep(&inode->wait);
     }
+    inode->pipe_busy++;
+    int nr = fifo_read(fifo, buf, count);
+    inode->pipe_busy--;
+    wait_wakeup(&inode->wait);
     return nr;
 }
 
-int pipe_write(inode_t *inode, char *buf, int count) {
+// 写入全部数据，管道满时唤醒读者并等待
+int pipe_write(inode_t *inode, char *buf, int count, int flags) {
     fifo_t *fifo = (fifo_t *)inode->desc;
     int nr = 0;
     while (nr < count) {
         if (fifo_full(fifo)) {
-            assert(inode->txwaiter == NULL);
-            inode->txwaiter = running_task();
-            task_block(inode->txwaiter, NULL, TASK_BLOCKED);
+            // 非阻塞时只写入能写的部分
+            if (flags & O_NONBLOCK) {
+                break;
+            }
+            wait_wakeup(&inode->wait);
+            wait_sleep(&inode->wait);
+            continue;
         }
-        fifo_put(fifo, buf[nr++]);
-        if (inode->rxwaiter) {
-            task_unblock(inode->rxwaiter);
-            inode->rxwaiter = NULL;
+        inode->pipe_busy++;
+        nr += fifo_write(fifo, buf + nr, count - nr);
+        inode->pipe_busy--;
+
+        // 超过一半时唤醒读者，不必等到写满
+        if (fifo_used(fifo) >= fifo->length / 2) {
+            wait_wakeup(&inode->wait);
         }
     }
-    return nr;
+    wait_wakeup(&inode->wait);
+    return nr ? nr : EOF;
+}
+
+static int pipe_poll(file_t *file, wait_queue_t **queue) {
+    inode_t *inode = file->inode;
+    fifo_t *fifo = (fifo_t *)inode->desc;
+    *queue = &inode->wait;
+    int events = 0;
+    if (!fifo_empty(fifo)) {
+        events |= POLLIN;
+    }
+    if (!fifo_full(fifo)) {
+        events |= POLLOUT;
+    }
+    return events;
+}
+
+static int pipe_file_read(file_t *file, char *buf, int count, off_t *offset) {
+    return pipe_read(file->inode, buf, count, file->flags);
+}
+
+static int pipe_file_write(file_t *file, char *buf, int count,
+                           off_t *offset) {
+    return pipe_write(file->inode, buf, count, file->flags);
+}
+
+file_op_t pipe_fop = {
+    .read = pipe_file_read,
+    .write = pipe_file_write,
+    .poll = pipe_poll,
+};
+
+int pipe_splice(inode_t *inode, file_t *out, off_t *offset, int count) {
+    fifo_t *fifo = (fifo_t *)inode->desc;
+    while (fifo_empty(fifo)) {
+        wait_sleep(&inode->wait);
+    }
+
+    // 直接写出缓冲中连续的数据，不经过用户空间
+    // file_write 可能睡眠，期间 ptr 指向管道缓冲，不能改变缓冲大小
+    int nr = 0;
+    inode->pipe_busy++;
+    while (nr < count && !fifo_empty(fifo)) {
+        char *ptr;
+        u32 span = fifo_span(fifo, &ptr);
+        u32 chars = MIN(span, count - nr);
+        int len = file_write(out, ptr, chars, offset);
+        if (len <= 0) {
+            break;
+        }
+        fifo_skip(fifo, len);
+        nr += len;
+    }
+    inode->pipe_busy--;
+    wait_wakeup(&inode->wait);
+    return nr ? nr : EOF;
+}
+
+// 将管道缓冲改为 size 字节，按页对齐，不能小于已有的数据
+// 有进程正在拷贝缓冲中的数据时失败
+int pipe_resize(inode_t *inode, u32 size) {
+    fifo_t *fifo = (fifo_t *)inode->desc;
+    if (inode->pipe_busy) {
+        return EOF;
+    }
+    u32 pages = div_round_up(size, PAGE_SIZE);
+    if (!pages || pages > PIPE_MAX_PAGES) {
+        return EOF;
+    }
+    if (pages * PAGE_SIZE == fifo->length) {
+        return fifo->length;
+    }
+    if (fifo_used(fifo) >= pages * PAGE_SIZE) {
+        return EOF;
+    }
+
+    char *buf = (char *)alloc_kpage(pages);
+    u32 used = fifo_read(fifo, buf, fifo_used(fifo));
+    free_kpage((u32)inode->buf, fifo->length / PAGE_SIZE);
+
+    inode->buf = (void *)buf;
+    fifo_init(fifo, buf, pages * PAGE_SIZE);
+    fifo->head = used;
+
+    // 缓冲变大，写者可以继续写入
+    wait_wakeup(&inode->wait);
+    return fifo->length;
 }
 
 int sys_pipe(fd_t pipefd[2]) {
@@ -0,0 +1,146 @@
+#include <oak/assert.h>
+#include <oak/device.h>
+#include <oak/fs.h>
+#include <oak/mutex.h>
+#include <oak/poll.h>
+#include <oak/stat.h>
+#include <oak/stdlib.h>
+#include <oak/task.h>
+#include <oak/types.h>
+
+extern u32 volatile jiffies;
+extern u32 jiffy; // ms per jiffiy
+
+int file_poll(file_t *file, wait_queue_t **queue) {
+    file_op_t *fop = file->inode->fop;
+    *queue = NULL;
+    if (fop->poll) {
+        return fop->poll(file, queue);
+    }
+
+    // 不支持查询的文件总是就绪
+    return POLLIN | POLLOUT;
+}
+
+// 检查 fds 中文件的就绪事件，没有就绪的文件时等待，timeout 小于 0 时一直等待
+static int do_poll(pollfd_t *fds, int nfds, int timeout) {
+    task_t *task = running_task();
+
+    // 每个文件在一个等待队列中等待
+    wait_entry_t entries[TASK_FILE_NR];
+    int waits = 0;
+    bool first = true;
+
+    u32 deadline = jiffies + div_round_up(MAX(timeout, 0), jiffy);
+
+    int count = 0;
+    while (true) {
+        for (int i = 0; i < nfds; i++) {
+            pollfd_t *pfd = &fds[i];
+            pfd->revents = 0;
+            if (pfd->fd < 0) {
+                continue;
+            }
+
+            if (pfd->fd >= TASK_FILE_NR || !task->files[pfd->fd]) {
+                pfd->revents = POLLNVAL;
+                count++;
+                continue;
+            }
+
+            wait_queue_t *queue;
+            int events = file_poll(task->files[pfd->fd], &queue);
+            pfd->revents = events & (pfd->events | POLLERR | POLLHUP);
+            if (pfd->revents) {
+                count++;
+            } else if (first && queue) {
+                wait_add(queue, &entries[waits++]);
+            }
+        }
+        first = false;
+
+        if (count || !timeout) {
+            break;
+        }
+
+        if (timeout < 0) {
+            task_block(task, NULL, TASK_BLOCKED);
+            continue;
+        }
+
+        if (jiffies >= deadline) {
+            break;
+        }
+        task_sleep((deadline - jiffies) * jiffy);
+    }
+
+    for (int i = 0; i < waits; i++) {
+        wait_remove(&entries[i]);
+    }
+    return count;
+}
+
+int sys_poll(pollfd_t *fds, int nfds, int timeout) {
+    if (nfds < 0 || nfds > TASK_FILE_NR) {
+        return EOF;
+    }
+    return do_poll(fds, nfds, timeout);
+}
+
+int sys_select(int nfds, fd_set *readfds, fd_set *writefds,
+               fd_set *exceptfds, int timeout) {
+    if (nfds < 0 || nfds > TASK_FILE_NR) {
+        return EOF;
+    }
+
+    pollfd_t fds[TASK_FILE_NR];
+    int count = 0;
+    for (fd_t fd = 0; fd < nfds; fd++) {
+        short events = 0;
+        if (readfds && FD_ISSET(fd, readfds)) {
+            events |= POLLIN;
+        }
+        if (writefds && FD_ISSET(fd, writefds)) {
+            events |= POLLOUT;
+        }
+        if (exceptfds && FD_ISSET(fd, exceptfds)) {
+            events |= POLLPRI;
+        }
+        if (!events) {
+            continue;
+        }
+        fds[count].fd = fd;
+        fds[count].events = events;
+        count++;
+    }
+
+    int ret = do_poll(fds, count, timeout);
+    if (ret < 0) {
+        return ret;
+    }
+
+    // 集合中只保留就绪的文件
+    ret = 0;
+    for (int i = 0; i < count; i++) {
+        pollfd_t *pfd = &fds[i];
+        if (pfd->revents & POLLNVAL) {
+            return EOF;
+        }
+        if (readfds && FD_ISSET(pfd->fd, readfds) &&
+            !(pfd->revents & POLLIN)) {
+            FD_CLR(pfd->fd, readfds);
+        }
+        if (writefds && FD_ISSET(pfd->fd, writefds) &&
+            !(pfd->revents & POLLOUT)) {
+            FD_CLR(pfd->fd, writefds);
+        }
+        if (exceptfds && FD_ISSET(pfd->fd, exceptfds) &&
+            !(pfd->revents & POLLPRI)) {
+            FD_CLR(pfd->fd, exceptfds);
+        }
+        ret += (pfd->revents & POLLIN) != 0;
+        ret += (pfd->revents & POLLOUT) != 0;
+        ret += (pfd->revents & POLLPRI) != 0;
+    }
+    return ret;
+}
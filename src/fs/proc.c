@@ -0,0 +1,196 @@
+/*
+ *  /proc 伪文件系统，只读，不需要块设备
+ *
+ *  根目录 inode 为 1，其中每个文件对应一个子系统的统计信息，inode 从 2 开始。
+ *  文件内容在每次读取时生成。
+ **/
+
+#include <oak/arena.h>
+#include <oak/assert.h>
+#include <oak/fs.h>
+#include <oak/memory.h>
+#include <oak/proc.h>
+#include <oak/slab.h>
+#include <oak/stat.h>
+#include <oak/stdarg.h>
+#include <oak/stdio.h>
+#include <oak/stdlib.h>
+#include <oak/string.h>
+#include <oak/types.h>
+
+extern time_t sys_time();
+
+#define PROC_ROOT 1        // 根目录 inode
+#define PROC_BUF_PAGES 2 // 生成文件内容的缓冲页数
+
+typedef struct proc_entry_t {
+    char *name;                   // 文件名
+    void (*show)(proc_buf_t *pb); // 生成文件内容
+} proc_entry_t;
+
+static void proc_memory_show(proc_buf_t *pb) {
+    memory_show(pb);
+    arena_show(pb);
+}
+
+static proc_entry_t proc_entries[] = {
+    {"buffers", buffer_show},       // 高速缓冲
+    {"memory", proc_memory_show},   // 物理页和内核堆
+    {"slabs", slab_show},           // 对象缓存
+    {"tasks", task_show},           // 进程
+    {"devices", device_show},       // 设备请求
+    {"inodes", inode_show},         // 内存中的 inode
+    {"interrupts", interrupt_show}, // 中断次数
+};
+
+#define PROC_ENTRY_NR (sizeof(proc_entries) / sizeof(proc_entry_t))
+
+static inode_op_t proc_inode_op;
+static file_op_t proc_file_op;
+
+// 直接输出到缓冲的剩余空间，vsnprintf 会在结尾写入 0，最后一个字节不计入内容
+void proc_printf(proc_buf_t *pb, const char *fmt, ...) {
+    u32 left = pb->size - pb->len;
+    if (left <= 1) {
+        return;
+    }
+
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(pb->data + pb->len, left, fmt, args);
+    va_end(args);
+
+    pb->len += MIN((u32)len, left - 1);
+}
+
+static int proc_read_super(super_block_t *sb) { return 0; }
+
+static void proc_read_inode(inode_t *inode) {
+    assert(inode->nr <= PROC_ENTRY_NR + 1);
+
+    inode_desc_t *desc = kmalloc(sizeof(inode_desc_t));
+    memset(desc, 0, sizeof(inode_desc_t));
+    if (inode->nr == PROC_ROOT) {
+        desc->mode = IFDIR | 0555;
+        desc->nlinks = 2;
+    } else {
+        desc->mode = IFREG | 0444;
+        desc->nlinks = 1;
+    }
+    desc->mtime = sys_time();
+
+    inode->desc = desc;
+    inode->buf = NULL;
+    inode->ctime = desc->mtime;
+    inode->atime = desc->mtime;
+    inode->op = &proc_inode_op;
+    inode->fop = &proc_file_op;
+}
+
+static void proc_put_inode(inode_t *inode) {
+    kfree(inode->desc);
+    inode->desc = NULL;
+}
+
+static super_op_t proc_super_op = {
+    .read_super = proc_read_super,
+    .read_inode = proc_read_inode,
+    .put_inode = proc_put_inode,
+};
+
+fs_type_t proc_fs_type = {"proc", true, &proc_super_op};
+
+static inode_t *proc_lookup(inode_t *dir, char *name, char **next) {
+    assert(dir->nr == PROC_ROOT);
+
+    if (match_name(name, ".", next)) {
+        dir->count++;
+        return dir;
+    }
+
+    for (size_t i = 0; i < PROC_ENTRY_NR; i++) {
+        if (match_name(name, proc_entries[i].name, next)) {
+            return iget(dir->dev, i + 2);
+        }
+    }
+    return NULL;
+}
+
+static inode_op_t proc_inode_op = {
+    .lookup = proc_lookup,
+};
+
+static int proc_read(file_t *file, char *buf, int count, off_t *offset) {
+    inode_t *inode = file->inode;
+    if (inode->nr == PROC_ROOT) {
+        return EOF;
+    }
+
+    proc_buf_t pb;
+    pb.data = (char *)alloc_kpage(PROC_BUF_PAGES);
+    pb.size = PROC_BUF_PAGES * PAGE_SIZE;
+    pb.len = 0;
+    proc_entries[inode->nr - 2].show(&pb);
+
+    int len = EOF;
+    if (*offset < pb.len) {
+        len = MIN(count, pb.len - *offset);
+        memcpy(buf, pb.data + *offset, len);
+        *offset += len;
+    }
+
+    free_kpage((u32)pb.data, PROC_BUF_PAGES);
+    return len;
+}
+
+// 目录项依次为 "."，".." 和各个文件，file->offset 是目录项的序号
+static int proc_getdents(file_t *file, getdent_t *dirp, u32 count) {
+    inode_t *dir = file->inode;
+    if (dir->nr != PROC_ROOT) {
+        return EOF;
+    }
+
+    u32 entries = PROC_ENTRY_NR + 2;
+    char *ptr = (char *)dirp;
+    char *end = ptr + count;
+
+    idx_t i = file->offset;
+    for (; i < entries; i++) {
+        char *name;
+        getdent_t dent;
+        if (i < 2) {
+            name = i ? ".." : ".";
+            dent.nr = PROC_ROOT;
+            dent.type = DT_DIR;
+        } else {
+            name = proc_entries[i - 2].name;
+            dent.nr = i;
+            dent.type = DT_REG;
+        }
+
+        u32 namelen = strlen(name);
+        u32 reclen = (sizeof(getdent_t) + namelen + 1 + 3) & ~3;
+        if (ptr + reclen > end) {
+            break;
+        }
+
+        dent.reclen = reclen;
+        dent.namelen = namelen;
+        memcpy(ptr, &dent, sizeof(getdent_t));
+        memcpy(((getdent_t *)ptr)->name, name, namelen + 1);
+        ptr += reclen;
+    }
+
+    // 缓冲放不下一个目录项
+    if (ptr == (char *)dirp && i < entries) {
+        return EOF;
+    }
+
+    file->offset = i;
+    return ptr - (char *)dirp;
+}
+
+static file_op_t proc_file_op = {
+    .read = proc_read,
+    .getdents = proc_getdents,
+};
@@ -31,6 +31,32 @@ int sys_stat(char *filename, stat_t *statbuf) {
     return 0;
 }
 
+// 获取相对于目录 dirfd 的文件状态，不需要再从根目录或当前目录查找
+int sys_fstatat(fd_t dirfd, char *filename, stat_t *statbuf) {
+    task_t *task = running_task();
+    inode_t *dir = task->ipwd;
+    if (dirfd != AT_FDCWD) {
+        file_t *file = fd_file(dirfd, EOF);
+        if (!file) {
+            return EOF;
+        }
+        dir = file->inode;
+        // 能查找目录项的 inode 才是目录，其他文件系统的目录也可以
+        if (!dir->op || !dir->op->lookup || !ISDIR(dir->desc->mode)) {
+            return EOF;
+        }
+    }
+
+    inode_t *inode = namei_at(dir, filename);
+    if (!inode) {
+        return EOF;
+    }
+
+    copy_stat(inode, statbuf);
+    iput(inode);
+    return 0;
+}
+
 int sys_fstat(fd_t fd, stat_t *statbuf) {
 
     if (fd >= TASK_FILE_NR) {
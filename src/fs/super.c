@@ -11,10 +11,38 @@
 #include <oak/types.h>
 
 #define SUPER_NR 16
+#define FS_TYPE_NR 8
+
+// 不需要块设备的文件系统使用的设备号，在真实的设备号之后
+#define NODEV_BASE 0x1000
 
 static super_block_t super_table[SUPER_NR];
 static super_block_t *root;
 
+static fs_type_t *fs_types[FS_TYPE_NR];
+
+static super_op_t minix_super_op;
+static fs_type_t minix_fs_type = {"minix", false, &minix_super_op};
+
+void register_fs(fs_type_t *type) {
+    for (size_t i = 0; i < FS_TYPE_NR; i++) {
+        if (!fs_types[i]) {
+            fs_types[i] = type;
+            return;
+        }
+    }
+    panic("no more file system type");
+}
+
+static fs_type_t *get_fs_type(char *name) {
+    for (size_t i = 0; i < FS_TYPE_NR; i++) {
+        if (fs_types[i] && !strcmp(fs_types[i]->name, name)) {
+            return fs_types[i];
+        }
+    }
+    return NULL;
+}
+
 static super_block_t *get_free_super() {
     for (size_t i = 0; i < SUPER_NR; i++) {
         super_block_t *sb = &super_table[i];
@@ -45,9 +73,17 @@ void put_super(super_block_t *sb) {
     if (sb->count)
         return;
 
-    sb->dev = EOF;
     iput(sb->imount);
     iput(sb->iroot);
+    if (sb->op->put_super) {
+        sb->op->put_super(sb);
+    }
+    sb->dev = EOF;
+}
+
+static void minix_put_super(super_block_t *sb) {
+    // 等待后台释放该设备上的块
+    truncate_sync(sb->dev);
 
     for (int i = 0; i < sb->desc->imap_blocks; i++)
         brelse(sb->imaps[i]);
@@ -57,25 +93,69 @@ void put_super(super_block_t *sb) {
     brelse(sb->buf);
 }
 
-// 从设备读取超级块
-super_block_t *read_super(dev_t dev) {
+// 统计块位图中空闲块的数量
+static u32 count_free_zones(super_block_t *sb) {
+    // 位图第 0 位保留，对应 firstdatazone - 1
+    u32 bits = sb->desc->zones - sb->desc->firstdatazone + 1;
+    u32 count = 0;
+
+    for (u32 bit = 0; bit < bits; bit++) {
+        buffer_t *buf = sb->zmaps[bit / BLOCK_BITS];
+        u8 byte = buf->data[(bit % BLOCK_BITS) / 8];
+        if (!(byte & (1 << (bit % 8)))) {
+            count++;
+        }
+    }
+    return count;
+}
+
+/*
+ *  @brief  读取文件系统 type 在设备 dev 上的超级块
+ *  @return  超级块，失败返回 NULL
+ *
+ *  不需要块设备的文件系统忽略 dev，分配一个不对应设备的设备号
+ */
+super_block_t *read_super(dev_t dev, fs_type_t *type) {
     // if super_table has
-    super_block_t *sb = get_super(dev);
+    super_block_t *sb = type->nodev ? NULL : get_super(dev);
     if (sb) {
         sb->count++;
         return sb;
     }
 
-    DEBUGK("reading super block of device %d\n", dev);
-
     sb = get_free_super();
+    if (type->nodev) {
+        dev = NODEV_BASE + (sb - super_table);
+    }
+
+    DEBUGK("reading %s super block of device %d\n", type->name, dev);
+
+    sb->dev = dev;
+    sb->count = 1;
+    sb->flags = 0;
+    sb->op = type->op;
+    sb->data = NULL;
+    if (sb->op->read_super(sb) < 0) {
+        sb->dev = EOF;
+        return NULL;
+    }
+    return sb;
+}
+
+super_block_t *read_minix_super(dev_t dev) {
+    return read_super(dev, &minix_fs_type);
+}
+
+static int minix_read_super(super_block_t *sb) {
+    dev_t dev = sb->dev;
     buffer_t *buf = bread(dev, 1);
     sb->buf = buf;
     sb->desc = (super_desc_t *)buf->data;
-    sb->dev = dev;
-    sb->count = 1;
 
-    assert(sb->desc->magic == MINIX1_MAGIC);
+    if (sb->desc->magic != MINIX1_MAGIC) {
+        brelse(buf);
+        return EOF;
+    }
 
     memset(sb->imaps, 0, sizeof(sb->imaps));
     memset(sb->zmaps, 0, sizeof(sb->zmaps));
@@ -101,16 +181,28 @@ super_block_t *read_super(dev_t dev) {
             break;
         }
     }
-    return sb;
+
+    sb->zfree = count_free_zones(sb);
+    sb->zreserved = 0;
+    return 0;
 }
 
+static super_op_t minix_super_op = {
+    .read_super = minix_read_super,
+    .put_super = minix_put_super,
+    .read_inode = minix_read_inode,
+    .write_inode = minix_write_inode,
+    .put_inode = minix_put_inode,
+};
+
 // 挂载 root
 static void mount_root() {
     DEBUGK("mount root file system\n");
     device_t *device = device_find(DEV_IDE_PART, 0);
     assert(device);
 
-    root = read_super(device->dev);
+    root = read_minix_super(device->dev);
+    root->flags = MS_RELATIME;
 
     // 初始化根目录 inode
     root->iroot = iget(device->dev, 1);  // 获得根目录 inode
@@ -129,29 +221,40 @@ void super_init() {
         sb->imount = NULL;
         list_init(&sb->inode_list);
     }
+    register_fs(&minix_fs_type);
+    register_fs(&proc_fs_type);
     mount_root();
 }
 
 /**
- *  @brief  系统调用 mount，挂载设备到目录
- *  @param  devname  设备名称
+ *  @brief  系统调用 mount，挂载文件系统到目录
+ *  @param  devname  设备名称，不需要块设备的文件系统忽略
  *  @param  dirname  目录名称
+ *  @param  type  文件系统类型，NULL 表示 minix
  *  @param  flags  标记
  *  @return  错误编码
  */
-int sys_mount(char *devname, char *dirname, int flags) {
-    DEBUGK("mount %s to %s\n", devname, dirname);
+int sys_mount(char *devname, char *dirname, char *type, int flags) {
+    DEBUGK("mount %s to %s type %s\n", devname ? devname : "none", dirname,
+           type ? type : "minix");
 
     inode_t *devinode = NULL;
     inode_t *dirinode = NULL;
     super_block_t *sb = NULL;
-    devinode = namei(devname);
-    if (!devinode)
-        goto rollback;
-    if (!ISBLK(devinode->desc->mode))
+    dev_t dev = EOF;
+
+    fs_type_t *fs = get_fs_type(type ? type : "minix");
+    if (!fs)
         goto rollback;
 
-    dev_t dev = devinode->desc->zone[0];
+    if (!fs->nodev) {
+        devinode = namei(devname);
+        if (!devinode)
+            goto rollback;
+        if (!ISBLK(devinode->desc->mode))
+            goto rollback;
+        dev = devinode->desc->zone[0];
+    }
 
     dirinode = namei(dirname);
     if (!dirinode)
@@ -163,13 +266,14 @@ int sys_mount(char *devname, char *dirname, int flags) {
     if (dirinode->count != 1 || dirinode->mount)
         goto rollback;
 
-    sb = read_super(dev);
-    if (sb->imount)
+    sb = read_super(dev, fs);
+    if (!sb || sb->imount)
         goto rollback;
 
-    sb->iroot = iget(dev, 1);
+    sb->flags = flags & (MS_NOATIME | MS_RELATIME | MS_LAZYTIME);
+    sb->iroot = iget(sb->dev, 1);
     sb->imount = dirinode;
-    dirinode->mount = dev;
+    dirinode->mount = sb->dev;
     iput(devinode);
     return 0;
 
@@ -242,6 +346,9 @@ int devmkfs(dev_t dev, u32 icount) {
     sb = get_free_super();
     sb->dev = dev;
     sb->count = 1;
+    sb->flags = 0;
+    sb->op = &minix_super_op;
+    sb->data = NULL;
 
     buf = bread(dev, 1);
     sb->buf = buf;
@@ -265,6 +372,9 @@ int devmkfs(dev_t dev, u32 icount) {
     desc->max_size = BLOCK_SIZE * TOTAL_BLOCK;
     desc->magic = MINIX1_MAGIC;
 
+    sb->zfree = zcount;
+    sb->zreserved = 0;
+
     // 清空位图
     memset(sb->imaps, 0, sizeof(sb->imaps));
     memset(sb->zmaps, 0, sizeof(sb->zmaps));
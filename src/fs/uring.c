@@ -0,0 +1,174 @@
+#include <oak/arena.h>
+#include <oak/assert.h>
+#include <oak/fs.h>
+#include <oak/memory.h>
+#include <oak/poll.h>
+#include <oak/stat.h>
+#include <oak/stdlib.h>
+#include <oak/string.h>
+#include <oak/task.h>
+#include <oak/types.h>
+#include <oak/uring.h>
+
+extern fd_t sys_open(char *filename, int flags, int mode);
+extern void sys_close(fd_t fd);
+
+/*
+ *  共享队列放在连续的内核页中，内核直接访问；
+ *  这些页作为 uring inode 的页缓存，用户通过 mmap MAP_SHARED 映射
+ */
+void uring_init(inode_t *inode, uring_params_t *params) {
+    uring_t *uring = (uring_t *)inode->desc;
+    uring->pages = div_round_up(params->size, PAGE_SIZE);
+    uring->sq_entries = params->sq_entries;
+    uring->cq_entries = params->cq_entries;
+
+    u32 vaddr = alloc_kpage(uring->pages);
+    memset((void *)vaddr, 0, uring->pages * PAGE_SIZE);
+    uring->ring = (uring_ring_t *)vaddr;
+    uring->sqes = (uring_sqe_t *)(vaddr + params->sq_off);
+    uring->cqes = (uring_cqe_t *)(vaddr + params->cq_off);
+    uring->ring->sq_entries = params->sq_entries;
+    uring->ring->cq_entries = params->cq_entries;
+
+    for (size_t i = 0; i < uring->pages; i++) {
+        page_cache_insert(inode, i, vaddr + i * PAGE_SIZE);
+    }
+}
+
+void uring_release(inode_t *inode) {
+    uring_t *uring = (uring_t *)inode->desc;
+    page_cache_drop(inode);
+    free_kpage((u32)uring->ring, uring->pages);
+}
+
+static int uring_poll(file_t *file, wait_queue_t **queue) {
+    uring_t *uring = (uring_t *)file->inode->desc;
+    uring_ring_t *ring = uring->ring;
+    int events = 0;
+    if (ring->cq_head != ring->cq_tail) {
+        events |= POLLIN;
+    }
+    if (ring->sq_tail - ring->sq_head < uring->sq_entries) {
+        events |= POLLOUT;
+    }
+    return events;
+}
+
+file_op_t uring_fop = {
+    .poll = uring_poll,
+};
+
+fd_t sys_uring_setup(u32 entries, uring_params_t *params) {
+    if (!entries || entries > URING_MAX_ENTRIES) {
+        return EOF;
+    }
+
+    // 队列长度取 2 的幂，下标取模时只需要与运算
+    u32 sq_entries = 1;
+    while (sq_entries < entries) {
+        sq_entries <<= 1;
+    }
+
+    params->sq_entries = sq_entries;
+    params->cq_entries = sq_entries * 2;
+    params->sq_off = sizeof(uring_ring_t);
+    params->cq_off = params->sq_off + sq_entries * sizeof(uring_sqe_t);
+    params->size = params->cq_off + params->cq_entries * sizeof(uring_cqe_t);
+
+    task_t *task = running_task();
+    fd_t fd = task_get_fd(task);
+    file_t *file = get_file();
+    task->files[fd] = file;
+
+    file->inode = get_uring_inode(params);
+    file->flags = O_RDWR;
+    file->mode = 0;
+    file->offset = 0;
+    return fd;
+}
+
+// 执行一个提交队列项，返回值放入完成队列项
+static int uring_submit(inode_t *inode, uring_sqe_t *sqe) {
+    file_t *file;
+    off_t *offset;
+
+    switch (sqe->opcode) {
+    case URING_OP_NOP:
+        return 0;
+    case URING_OP_READ:
+        file = fd_file(sqe->fd, O_WRONLY);
+        if (!file || !sqe->len) {
+            return EOF;
+        }
+        offset = (sqe->offset == EOF) ? &file->offset : &sqe->offset;
+        return file_read(file, (char *)sqe->addr, sqe->len, offset);
+    case URING_OP_WRITE:
+        file = fd_file(sqe->fd, O_RDONLY);
+        if (!file || !sqe->len) {
+            return EOF;
+        }
+        offset = (sqe->offset == EOF) ? &file->offset : &sqe->offset;
+        return file_write(file, (char *)sqe->addr, sqe->len, offset);
+    case URING_OP_OPEN:
+        return sys_open((char *)sqe->addr, sqe->flags, sqe->mode);
+    case URING_OP_CLOSE:
+        file = fd_file(sqe->fd, EOF);
+        // 不能在处理队列时关闭 uring 自身
+        if (!file || file->inode == inode) {
+            return EOF;
+        }
+        sys_close(sqe->fd);
+        return 0;
+    case URING_OP_FSYNC:
+        file = fd_file(sqe->fd, EOF);
+        // 只有 minix 文件有延迟分配的块需要写回
+        if (!file || file->inode->fop != &minix_file_op) {
+            return EOF;
+        }
+        return inode_sync(file->inode);
+    default:
+        return EOF;
+    }
+}
+
+/*
+ *  处理最多 to_submit 个提交队列项，返回处理的数量
+ *
+ *  各个操作在调用进程的上下文中依次完成，返回时结果都已放入完成队列，
+ *  一次系统调用可以完成多个操作。完成队列满时停止处理
+ */
+int sys_uring_enter(fd_t fd, u32 to_submit) {
+    file_t *file = fd_file(fd, EOF);
+    if (!file || !file->inode->uring) {
+        return EOF;
+    }
+
+    inode_t *inode = file->inode;
+    uring_t *uring = (uring_t *)inode->desc;
+    uring_ring_t *ring = uring->ring;
+    u32 count = 0;
+    while (count < to_submit) {
+        u32 head = ring->sq_head;
+        if (head == ring->sq_tail) {
+            break;
+        }
+        if (ring->cq_tail - ring->cq_head >= uring->cq_entries) {
+            break;
+        }
+
+        // 复制提交队列项，避免执行时被用户修改
+        uring_sqe_t sqe = uring->sqes[head & (uring->sq_entries - 1)];
+        ring->sq_head = head + 1;
+
+        int res = uring_submit(inode, &sqe);
+
+        u32 tail = ring->cq_tail;
+        uring_cqe_t *cqe = &uring->cqes[tail & (uring->cq_entries - 1)];
+        cqe->data = sqe.data;
+        cqe->res = res;
+        ring->cq_tail = tail + 1;
+        count++;
+    }
+    return count;
+}
@@ -1,24 +1,14 @@
 #ifndef OAK_ARENA_H
 #define OAK_ARENA_H
 
-#include <oak/list.h>
 #include <oak/types.h>
 
-#define DESC_COUNT 7
-
-typedef list_node_t block_t;
-
-typedef struct arena_descriptor_t {
-    u32 total_block;  // block amount in a page
-    u32 block_size;   // block size
-    list_t free_list; // free bolck list
-} arena_descriptor_t;
+#define DESC_COUNT 7 // size classes of kmalloc, 16 to 1024 bytes
 
+// header of pages allocated for more than 1024 bytes
 typedef struct arena_t {
-    arena_descriptor_t *desc; // descriptor
-    u32 count;                // left blocks or pages
-    u32 large;                // larger than 1024 bytes
     u32 magic;
+    u32 count; // page amount
 } arena_t;
 
 void *kmalloc(size_t size);
@@ -15,13 +15,22 @@ typedef struct buffer_t {
     int count;         // reference times
     list_node_t hnode; // hash
     list_node_t rnode; // buffer node
+    list_node_t dnode; // node in inode's delay list
     lock_t lock;
     bool dirty;
     bool valid;
+    bool delay; // block not allocated on disk yet, block is file block
 } buffer_t;
 
 buffer_t *getblk(dev_t dev, idx_t block);
 buffer_t *bread(dev_t dev, idx_t block);
 void bwrite(buffer_t *bf);
 void brelse(buffer_t *bf);
+
+buffer_t *getblk_delay(dev_t dev);       // buffer for delayed allocation
+void bassign(buffer_t *bf, idx_t block); // bind delayed buffer to block
+void bdiscard(buffer_t *bf);             // drop delayed buffer
+
+// update cached block after writing data to device directly
+void brefresh(dev_t dev, idx_t block, void *data);
 #endif // !OAK_BUFFER_H
@@ -24,8 +24,11 @@ enum device_subtype_t {
 enum device_cmd_t {
     DEV_CMD_SECTOR_START = 1, // get start sector lba
     DEV_CMD_SECTOR_COUNT,     // get sector amount
+    DEV_CMD_POLL,             // get ready events and wait queue of device
 };
 
+#define DEV_NONBLOCK 0x1 // return at once if device is not ready
+
 #define REQ_READ 0  // block device read
 #define REQ_WRITE 1 // block device write
 
@@ -52,6 +55,9 @@ typedef struct device_t {
     void *ptr;           // device pointer
     list_t request_list; // block device request list
     bool direct;         // seek direction
+    u32 reads;           // read requests
+    u32 writes;          // write requests
+    u32 sectors;         // sectors requested
     // device control
     int (*ioctl)(void *dev, int cmd, void *args, int flags);
     // read device
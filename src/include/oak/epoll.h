@@ -0,0 +1,49 @@
+#ifndef OAK_EPOLL_H
+#define OAK_EPOLL_H
+
+#include <oak/list.h>
+#include <oak/mutex.h>
+#include <oak/poll.h>
+#include <oak/types.h>
+
+// epoll 事件，与 poll 事件相同
+#define EPOLLIN POLLIN
+#define EPOLLPRI POLLPRI
+#define EPOLLOUT POLLOUT
+#define EPOLLERR POLLERR
+#define EPOLLHUP POLLHUP
+#define EPOLLET (1 << 31) // 边沿触发
+
+// epoll_ctl 操作
+enum epoll_ctl_t {
+    EPOLL_CTL_ADD = 1, // 添加关注的文件
+    EPOLL_CTL_DEL = 2, // 删除关注的文件
+    EPOLL_CTL_MOD = 3, // 修改关注的事件
+};
+
+typedef struct epoll_event_t {
+    u32 events; // 关注或发生的事件
+    u32 data;   // 用户数据，原样返回
+} epoll_event_t;
+
+// epoll 对象
+typedef struct epoll_t {
+    list_t items;      // 关注的文件
+    list_t ready;      // 就绪的文件，由设备唤醒时加入
+    wait_queue_t wait; // 等待就绪的进程
+} epoll_t;
+
+// 关注的文件
+typedef struct epitem_t {
+    epoll_t *ep;           // 所属 epoll 对象
+    fd_t fd;               // 文件描述符
+    struct file_t *file;   // 文件
+    epoll_event_t event;   // 关注的事件
+    wait_queue_t *queue;   // 文件的等待队列
+    wait_entry_t entry;    // 在文件等待队列中的结点
+    bool ready;            // 是否在就绪链表中
+    list_node_t node;      // 关注链表结点
+    list_node_t rnode;     // 就绪链表结点
+} epitem_t;
+
+#endif // !OAK_EPOLL_H
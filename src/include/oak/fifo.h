@@ -15,5 +15,11 @@ bool fifo_full(fifo_t *fifo);
 bool fifo_empty(fifo_t *fifo);
 char fifo_get(fifo_t *fifo);
 void fifo_put(fifo_t *fifo, char byte);
+u32 fifo_span(fifo_t *fifo, char **ptr);
+void fifo_skip(fifo_t *fifo, u32 count);
+u32 fifo_used(fifo_t *fifo);
+u32 fifo_free(fifo_t *fifo);
+u32 fifo_read(fifo_t *fifo, char *buf, u32 count);
+u32 fifo_write(fifo_t *fifo, char *buf, u32 count);
 
 #endif
@@ -4,6 +4,7 @@
 #include <oak/buffer.h>
 #include <oak/device.h>
 #include <oak/list.h>
+#include <oak/mutex.h>
 #include <oak/types.h>
 
 #define BLOCK_SIZE 1024
@@ -45,8 +46,26 @@ enum file_flag {
     O_TRUNC = 01000,    // 若文件已存在且是写操作，则长度截为 0
     O_APPEND = 02000,   // 以添加方式打开，文件指针置为文件尾
     O_NONBLOCK = 04000, // 非阻塞方式打开和操作文件
+    O_DIRECT = 040000,  // 块设备文件读写不经过高速缓冲
 };
 
+// fcntl 命令
+enum fcntl_cmd {
+    F_GETFL = 3,         // 获取文件标记
+    F_SETFL = 4,         // 设置文件标记，只能修改 O_APPEND O_NONBLOCK O_DIRECT
+    F_SETPIPE_SZ = 1031, // 设置管道缓冲大小
+    F_GETPIPE_SZ = 1032, // 获取管道缓冲大小
+};
+
+// 挂载标记
+enum mount_flag {
+    MS_NOATIME = 02000,       // 不更新访问时间
+    MS_RELATIME = 010000000,  // 访问时间早于修改时间或超过一天才更新
+    MS_LAZYTIME = 0200000000, // 只修改时间戳的 inode 在释放或同步时写回
+};
+
+#define RELATIME_INTERVAL (24 * 60 * 60) // relatime 访问时间的最长更新间隔
+
 typedef struct inode_desc_t {
     u16 mode;    // file type and attribute (rwx bit)
     u16 uid;     // user id
@@ -57,6 +76,49 @@ typedef struct inode_desc_t {
     u16 zone[9]; // direct (0-6), indirect (7) or double indirect (8)
 } inode_desc_t;
 
+struct inode_t;
+struct file_t;
+struct super_block_t;
+struct getdent_t;
+
+// inode 操作，由文件系统提供
+typedef struct inode_op_t {
+    // 在目录 dir 中查找路径 name 的第一项，返回对应的 inode，next 指向下一项
+    struct inode_t *(*lookup)(struct inode_t *dir, char *name, char **next);
+    // 释放文件的所有数据，不支持时为 NULL
+    void (*truncate)(struct inode_t *inode);
+} inode_op_t;
+
+// 文件操作，不支持的操作为 NULL
+typedef struct file_op_t {
+    int (*read)(struct file_t *file, char *buf, int count, off_t *offset);
+    int (*write)(struct file_t *file, char *buf, int count, off_t *offset);
+    // 就绪事件，queue 返回可以等待就绪的队列；为 NULL 时总是就绪
+    int (*poll)(struct file_t *file, wait_queue_t **queue);
+    int (*getdents)(struct file_t *file, struct getdent_t *dirp, u32 count);
+} file_op_t;
+
+// 超级块操作
+typedef struct super_op_t {
+    // 读取超级块，成功返回 0
+    int (*read_super)(struct super_block_t *sb);
+    // 释放超级块的数据，可以为 NULL
+    void (*put_super)(struct super_block_t *sb);
+    // 读取 inode->nr 对应的 inode，设置 desc 和操作
+    void (*read_inode)(struct inode_t *inode);
+    // 每次释放引用时写回 inode，可以为 NULL
+    void (*write_inode)(struct inode_t *inode);
+    // 释放最后一个引用时释放 inode 的数据，可以为 NULL
+    void (*put_inode)(struct inode_t *inode);
+} super_op_t;
+
+// 文件系统类型
+typedef struct fs_type_t {
+    char *name;     // 类型名称，mount 时指定
+    bool nodev;     // 不需要块设备
+    super_op_t *op; // 超级块操作
+} fs_type_t;
+
 typedef struct inode_t {
     inode_desc_t *desc;
     struct buffer_t *buf;
@@ -67,9 +129,17 @@ typedef struct inode_t {
     time_t ctime;     // change time
     list_node_t node; // node store in super_block_t's inode_list
     dev_t mount;
-    struct task_t *rxwaiter;
-    struct task_t *txwaiter;
+    wait_queue_t wait; // tasks waiting for pipe
     bool pipe;
+    u32 pipe_busy; // tasks copying with pipe buffer, which can't be resized
+    bool epoll;
+    bool uring;
+    list_t delay_list; // buffers of delayed allocation, sorted by file block
+    u32 delays;        // amount of delayed blocks
+    u32 dmeta;         // indirect blocks reserved for delayed blocks
+    inode_op_t *op;    // inode operations
+    file_op_t *fop;    // file operations
+    void *data;        // private data of file system
 } inode_t;
 
 // super block
@@ -94,6 +164,11 @@ typedef struct super_block_t {
     list_t inode_list; // list contains the inode read to memory yet
     inode_t *iroot;    // inode of root directory
     inode_t *imount;
+    u32 zfree;      // free block amount
+    u32 zreserved;  // blocks reserved by delayed allocation
+    int flags;      // mount flags
+    super_op_t *op; // super block operations
+    void *data;     // private data of file system
 } super_block_t;
 
 // directory
@@ -112,6 +187,27 @@ typedef struct file_t {
 
 typedef dentry_t dirent_t;
 
+// getdents 返回的变长目录项
+typedef struct getdent_t {
+    u16 nr;      // inode
+    u16 reclen;  // 目录项长度，4 字节对齐
+    u8 type;     // 文件类型 DT_*
+    u8 namelen;  // 文件名长度
+    char name[]; // 以 0 结尾的文件名
+} getdent_t;
+
+// 目录项的文件类型，即文件属性中的文件类型右移 12 位
+#define DT_UNKNOWN 0
+#define DT_FIFO 1
+#define DT_CHR 2
+#define DT_DIR 4
+#define DT_BLK 6
+#define DT_REG 8
+#define DT_LNK 10
+#define DT_SOCK 12
+
+#define AT_FDCWD -100 // fstatat 相对于当前目录
+
 typedef enum whence_t {
     SEEK_SET = 1, // 直接设置偏移
     SEEK_CUR,     // 当前位置偏移
@@ -119,38 +215,82 @@ typedef enum whence_t {
 } whence_t;
 
 super_block_t *get_super(dev_t dev);
-super_block_t *read_super(dev_t dev);
-
-idx_t balloc(dev_t dev);          // allocate a file block
-void bfree(dev_t dev, idx_t idx); // release a file block
-idx_t ialloc(dev_t dev);          // allocate an inode
-void ifree(dev_t dev, idx_t idx); // release inode
+// 读取文件系统 type 在设备 dev 上的超级块
+super_block_t *read_super(dev_t dev, fs_type_t *type);
+super_block_t *read_minix_super(dev_t dev);
+void register_fs(fs_type_t *type); // 注册文件系统类型
+
+extern inode_op_t minix_inode_op;
+extern file_op_t minix_file_op;
+void minix_read_inode(inode_t *inode);
+void minix_write_inode(inode_t *inode);
+void minix_put_inode(inode_t *inode);
+
+idx_t balloc(dev_t dev);                 // allocate a file block
+idx_t balloc_run(dev_t dev, u32 *count); // allocate continuous file blocks
+void bfree(dev_t dev, idx_t idx);        // release a file block
+void bclear(dev_t dev, idx_t idx);       // release a file block, map later
+void bsync(dev_t dev);                   // write back dirty block bitmap
+idx_t ialloc(dev_t dev);                 // allocate an inode
+void ifree(dev_t dev, idx_t idx);        // release inode
 
 // 获取 inode 第 block 块的索引值
 // 如果不存在 且 create 为 true，则创建
 idx_t bmap(inode_t *inode, idx_t block, bool create);
 
+// 将 inode 第 block 块映射到文件块 zone，用于延迟分配，间接块分配失败返回 EOF
+int bmap_assign(inode_t *inode, idx_t block, idx_t zone);
+
 inode_t *get_root_inode();               // 获取根目录 inode
 inode_t *iget(dev_t dev, idx_t nr);      // 获得设备 dev 的 nr inode
 void iput(inode_t *inode);               // 释放 inode
 inode_t *new_inode(dev_t dev, idx_t nr); // 创建新 inode
 
+// 检查路径 path 的第一项是否是 entry_name，next 指向下一项
+bool match_name(const char *path, const char *entry_name, char **next);
+
 inode_t *named(char *pathname, char **next); // 获取 pathname 对应的父目录 inode
 inode_t *namei(char *pathname);              // 获取 pathname 对应的 inode
 
+// 获取 pathname 对应的 inode，相对路径从目录 dir 开始查找
+inode_t *namei_at(inode_t *dir, char *pathname);
+
 // 打开文件，返回 inode
 inode_t *inode_open(char *pathname, int flag, int mode);
 
+// 读取文件第 block 块的缓冲，块不存在返回 NULL，读出为 hole_block
+struct buffer_t *inode_buffer(inode_t *inode, idx_t block);
+
+// 文件中没有磁盘块的部分读出的内容，全为 0
+extern char hole_block[BLOCK_SIZE];
+
+// 按照挂载标记更新 inode 的访问时间
+void inode_access(inode_t *inode);
+
 // 从 inode 的 offset 处，读 len 个字节到 buf
 int inode_read(inode_t *inode, char *buf, u32 len, off_t offset);
 
 // 从 inode 的 offset 处，将 buf 的 len 个字节写入磁盘
 int inode_write(inode_t *inode, char *buf, u32 len, off_t offset);
 
+// 从 inode 的 offset 处，依次读入 iov 中的各个缓冲
+int inode_readv(inode_t *inode, iovec_t *iov, int iovcnt, off_t offset);
+
+// 从 inode 的 offset 处，依次写入 iov 中的各个缓冲
+int inode_writev(inode_t *inode, iovec_t *iov, int iovcnt, off_t offset);
+
+// 写回 inode 延迟分配的块和位图，磁盘空间不足返回 EOF
+int inode_sync(inode_t *inode);
+
 // release all file blocks in inode
 void inode_truncate(inode_t *inode);
 
+// release the blocks of truncated files on device dev right now
+void truncate_sync(dev_t dev);
+
 file_t *get_file();
+// 获取 fd 对应的文件，文件的访问模式不能是 mode
+file_t *fd_file(fd_t fd, int mode);
 void put_file(file_t *file);
 
 int devmkfs(dev_t dev, u32 icount);
@@ -162,7 +302,43 @@ int devmkfs(dev_t dev, u32 icount);
 bool permission(inode_t *inode, u16 mask);
 
 inode_t *get_pipe_inode();
-int pipe_read(inode_t *inode, char *buf, int count);
-int pipe_write(inode_t *inode, char *buf, int count);
+int pipe_read(inode_t *inode, char *buf, int count, int flags);
+int pipe_write(inode_t *inode, char *buf, int count, int flags);
+extern file_op_t pipe_fop;
+
+struct epoll_t;
+
+inode_t *get_epoll_inode();
+void epoll_init(struct epoll_t *ep);
+void epoll_release(struct epoll_t *ep);
+extern file_op_t epoll_fop;
+
+struct uring_params_t;
+
+inode_t *get_uring_inode(struct uring_params_t *params);
+void uring_init(inode_t *inode, struct uring_params_t *params);
+void uring_release(inode_t *inode);
+extern file_op_t uring_fop;
+
+extern fs_type_t proc_fs_type;
+
+// 文件的就绪事件，queue 返回可以等待就绪的队列
+int file_poll(file_t *file, wait_queue_t **queue);
+
+// 通过高速缓冲读写块设备文件
+int blkdev_read(file_t *file, char *buf, int count, off_t *offset);
+int blkdev_write(file_t *file, char *buf, int count, off_t *offset);
+
+// 修改管道缓冲大小
+int pipe_resize(inode_t *inode, u32 size);
+
+// 将管道中的数据直接写入文件 out
+int pipe_splice(inode_t *inode, file_t *out, off_t *offset, int count);
+
+// 从文件的 offset 处读 count 个字节到 buf
+int file_read(file_t *file, char *buf, int count, off_t *offset);
+
+// 将 buf 的 count 个字节写入文件的 offset 处
+int file_write(file_t *file, char *buf, int count, off_t *offset);
 
 #endif // !OAK_FS_H
@@ -36,6 +36,8 @@ typedef struct gate_t {
 
 typedef void *handler_t;
 
+extern u32 interrupt_count[IDT_SIZE]; // times of each interrupt vector
+
 void send_eoi(int vector);
 
 void set_interrupt_handler(u32 irq, handler_t handler);
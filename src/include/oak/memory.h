@@ -1,6 +1,7 @@
 #ifndef OAK_MEMORY_H
 #define OAK_MEMORY_H
 
+#include <oak/list.h>
 #include <oak/types.h>
 
 #define PAGE_SIZE 0x1000 // 4K per page
@@ -9,12 +10,20 @@
 #define MEMORY_BASE 0x100000
 
 #define KERNEL_MEMORY_SIZE 0x1000000 // memory occupied by kernel
+#define KERNEL_KPAGE_SIZE 0x400000   // kernel pages after memory map
 
-#define KERNEL_BUFFER_MEM 0x800000
-#define KERNEL_BUFFER_SIZE 0x400000
+// buffer cache and ramdisk are 1/8 of memory each, sized in memory_map_init
+#define KERNEL_BUFFER_MIN 0x100000
+#define KERNEL_RAMDISK_MIN 0x100000
+#define KERNEL_RAMDISK_MAX 0x400000
 
-#define KERNEL_RAMDISK_MEM (KERNEL_BUFFER_MEM + KERNEL_BUFFER_SIZE)
-#define KERNEL_RAMDISK_SIZE 0x400000
+// memory map of more memory doesn't fit in kernel memory
+#define MEMORY_SIZE_MAX 0x20000000 // 512M
+
+extern u32 kernel_buffer_mem;   // buffer cache address
+extern u32 kernel_buffer_size;  // buffer cache size
+extern u32 kernel_ramdisk_mem;  // ramdisk address
+extern u32 kernel_ramdisk_size; // ramdisk size
 
 #define USER_STACK_TOP 0x10000000 // user stack top address, 256M
 #define USER_STACK_SIZE 0x200000  // 2M
@@ -27,6 +36,12 @@
 
 #define KERNEL_PAGE_DIR 0x1000 // page directory address
 
+// pages handled by one page fault, in a window aligned to its size.
+// must be a power of 2 and no more than 1024, 1 disables fault-around
+#define FAULT_AROUND_PAGES 16
+
+#define TLB_BATCH_NR 32 // most pages invalidated one by one in a batch
+
 typedef struct page_entry_t {
     u8 present : 1;
     u8 write : 1;
@@ -35,7 +50,7 @@ typedef struct page_entry_t {
     u8 pdt : 1;
     u8 accessed : 1;
     u8 dirty : 1;
-    u8 pat : 1;
+    u8 pat : 1; // page size in page directory entry, 4M page
     u8 global : 1;
     u8 shared : 1;
     u8 private : 1;
@@ -43,6 +58,17 @@ typedef struct page_entry_t {
     u32 index : 20;
 } _packed page_entry_t;
 
+// memory mapped area of task
+typedef struct mmap_t {
+    u32 start;             // start address
+    u32 end;               // end address
+    int prot;              // page protection
+    int flags;             // MAP_SHARED or MAP_PRIVATE
+    struct inode_t *inode; // mapped file, NULL for anonymous mapping
+    off_t offset;          // file offset of start address
+    list_node_t node;      // node in task's mmap list
+} mmap_t;
+
 u32 get_cr2();
 u32 get_cr3();
 void set_cr3(u32 pde);
@@ -50,14 +76,56 @@ void set_cr3(u32 pde);
 u32 alloc_kpage(u32 count);
 void free_kpage(u32 vaddr, u32 count);
 
+// allocate 2^order physically continuous pages, aligned to the block size
+u32 page_alloc(u32 order);
+// free pages allocated by page_alloc
+void page_free(u32 addr, u32 order);
+
+u32 alloc_zero_kpage(); // allocate a zeroed kernel page
+void zero_refill();     // refill pools of zeroed pages, called when idle
+
 page_entry_t *get_entry(u32 vaddr, bool create);
 
 void flush_tlb(u32 vaddr);
 
+// pages whose tlb entries are invalidated together
+typedef struct tlb_batch_t {
+    u32 count;               // pages added, flush all if more than TLB_BATCH_NR
+    u32 pages[TLB_BATCH_NR]; // page addresses
+} tlb_batch_t;
+
+void tlb_batch_init(tlb_batch_t *batch);
+void tlb_batch_add(tlb_batch_t *batch, u32 vaddr);
+void tlb_batch_range(tlb_batch_t *batch, u32 start, u32 end);
+void tlb_batch_flush(tlb_batch_t *batch);
+
 void link_page(u32 vaddr);
 void unlink_page(u32 vaddr);
 
 page_entry_t *copy_pde();
+page_entry_t *create_pde(); // page directory with kernel mapping only
 
 void free_pde();
+
+struct task_t;
+
+// map file pages of inode privately at vaddr, filled on page fault
+void mmap_file(u32 vaddr, size_t length, int prot, struct inode_t *inode,
+               off_t offset);
+
+void mmap_fork(struct task_t *child); // copy mmap areas to child task
+void mmap_exit();                     // unmap all areas of running task
+
+// release the page cache of inode
+void page_cache_drop(struct inode_t *inode);
+
+// clear the cached pages of truncated inode, which may still be mapped
+void page_cache_zero(struct inode_t *inode);
+
+// add kernel page paddr to the page cache of inode as page index
+void page_cache_insert(struct inode_t *inode, idx_t index, u32 paddr);
+
+// update cached pages of inode after writing len bytes of buf at offset
+void page_cache_write(struct inode_t *inode, char *buf, u32 len, off_t offset);
+
 #endif // !OAK_MEMORY_H
@@ -22,4 +22,22 @@ void mutex_unlock(mutex_t *mutex);
 void lock_init(lock_t *lock);
 void lock_acquire(lock_t *lock);
 void lock_release(lock_t *lock);
+
+// wait queue, a task can wait on several queues at once
+typedef struct wait_queue_t {
+    list_t entries;
+} wait_queue_t;
+
+typedef struct wait_entry_t {
+    struct task_t *task; // waiting task
+    // called instead of waking task up if not NULL
+    void (*func)(struct wait_entry_t *entry);
+    list_node_t node; // node in wait queue
+} wait_entry_t;
+
+void wait_init(wait_queue_t *queue);
+void wait_add(wait_queue_t *queue, wait_entry_t *entry);
+void wait_remove(wait_entry_t *entry);
+void wait_sleep(wait_queue_t *queue); // block until the queue is woken up
+void wait_wakeup(wait_queue_t *queue);
 #endif // !OAK_MUTEX_H
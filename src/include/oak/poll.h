@@ -0,0 +1,29 @@
+#ifndef OAK_POLL_H
+#define OAK_POLL_H
+
+#include <oak/types.h>
+
+// poll 事件
+#define POLLIN 0x001   // 有数据可读
+#define POLLPRI 0x002  // 有紧急数据可读
+#define POLLOUT 0x004  // 可以写入
+#define POLLERR 0x008  // 出错
+#define POLLHUP 0x010  // 挂断
+#define POLLNVAL 0x020 // 文件描述符无效
+
+typedef struct pollfd_t {
+    fd_t fd;       // 文件描述符
+    short events;  // 关心的事件
+    short revents; // 发生的事件
+} pollfd_t;
+
+// select 文件描述符集合，进程最多 TASK_FILE_NR 个文件
+typedef u32 fd_set;
+
+#define FD_SETSIZE 32
+#define FD_ZERO(set) (*(set) = 0)
+#define FD_SET(fd, set) (*(set) |= (1 << (fd)))
+#define FD_CLR(fd, set) (*(set) &= ~(1 << (fd)))
+#define FD_ISSET(fd, set) ((*(set) >> (fd)) & 1)
+
+#endif // !OAK_POLL_H
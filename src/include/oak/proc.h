@@ -0,0 +1,25 @@
+#ifndef OAK_PROC_H
+#define OAK_PROC_H
+
+#include <oak/types.h>
+
+// /proc 文件的内容缓冲，读取时生成
+typedef struct proc_buf_t {
+    char *data; // buffer
+    u32 size;   // buffer size
+    u32 len;    // text length
+} proc_buf_t;
+
+// 格式化输出到缓冲，超出缓冲大小的部分被丢弃
+void proc_printf(proc_buf_t *pb, const char *fmt, ...);
+
+// 各个子系统的统计信息
+void buffer_show(proc_buf_t *pb);    // /proc/buffers
+void memory_show(proc_buf_t *pb);    // /proc/memory
+void arena_show(proc_buf_t *pb);     // /proc/memory, kmalloc
+void task_show(proc_buf_t *pb);      // /proc/tasks
+void device_show(proc_buf_t *pb);    // /proc/devices
+void inode_show(proc_buf_t *pb);     // /proc/inodes
+void interrupt_show(proc_buf_t *pb); // /proc/interrupts
+
+#endif // !OAK_PROC_H
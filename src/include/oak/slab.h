@@ -0,0 +1,43 @@
+#ifndef OAK_SLAB_H
+#define OAK_SLAB_H
+
+#include <oak/list.h>
+#include <oak/types.h>
+
+#define SLAB_NAME_LEN 16
+
+struct proc_buf_t;
+
+// 对象缓存，每个 slab 占一页
+typedef struct kmem_cache_t {
+    char name[SLAB_NAME_LEN]; // cache name
+    u32 size;                 // object size
+    u32 count;                // objects per slab
+    u32 offset;               // offset of first object in slab, no color
+    u32 colors;               // color amount
+    u32 color;                // color of next slab
+    void (*ctor)(void *obj);  // constructor, called when slab is created
+    list_t partial;           // slabs with both used and free objects
+    list_t full;              // slabs without free objects
+    list_t empty;             // slabs with all objects free
+    u32 slabs;                // slab amount
+    u32 active;               // objects in use
+    u32 allocs;               // times of allocation
+    u32 frees;                // times of free
+} kmem_cache_t;
+
+// create cache for objects of size bytes, ctor can be NULL
+kmem_cache_t *kmem_cache_create(char *name, u32 size, void (*ctor)(void *));
+
+// allocate an object, constructed if cache has ctor
+void *kmem_cache_alloc(kmem_cache_t *cache);
+
+// free an object, which must be in the state after construction
+void kmem_cache_free(kmem_cache_t *cache, void *obj);
+
+// get cache of object allocated from slab
+kmem_cache_t *kmem_cache_find(void *obj);
+
+void slab_show(struct proc_buf_t *pb); // /proc/slabs
+
+#endif // !OAK_SLAB_H
@@ -2,8 +2,10 @@
 #define OAK_STDIO_H
 
 #include <oak/stdarg.h>
+#include <oak/types.h>
 
 int vsprintf(char *buf, const char *fmt, va_list args);
+int vsnprintf(char *buf, size_t size, const char *fmt, va_list args);
 int sprintf(char *buf, const char *fmt, ...);
 int printf(const char *fmt, ...);
 
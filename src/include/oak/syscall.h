@@ -1,8 +1,11 @@
 #ifndef OAK_SYSCALL_H
 #define OAK_SYSCALL_H
 
+#include <oak/epoll.h>
+#include <oak/poll.h>
 #include <oak/stat.h>
 #include <oak/types.h>
+#include <oak/uring.h>
 
 typedef enum syscall_t {
     SYS_NR_TEST,
@@ -31,19 +34,37 @@ typedef enum syscall_t {
     SYS_NR_DUP = 41,
     SYS_NR_PIPE = 42,
     SYS_NR_BRK = 45,
+    SYS_NR_FCNTL = 55,
     SYS_NR_UMASK = 60,
     SYS_NR_CHROOT = 62,
     SYS_NR_DUP2 = 63,
     SYS_NR_GETPPID = 64,
+    SYS_NR_SELECT = 82,
     SYS_NR_READDIR = 89,
     SYS_NR_MMAP = 90,
     SYS_NR_MUNMAP = 91,
+    SYS_NR_GETDENTS = 141,
+    SYS_NR_READV = 145,
+    SYS_NR_WRITEV = 146,
     SYS_NR_SLEEP = 158,
     SYS_NR_YIELD = 162,
+    SYS_NR_POLL = 168,
+    SYS_NR_PREAD = 180,
+    SYS_NR_PWRITE = 181,
     SYS_NR_GETCWD = 183,
+    SYS_NR_SENDFILE = 187,
+    SYS_NR_VFORK = 190,
 
     SYS_NR_CLEAR = 200,
     SYS_NR_MKFS = 201,
+    SYS_NR_SPLICE = 202,
+    SYS_NR_EPOLL_CREATE = 203,
+    SYS_NR_EPOLL_CTL = 204,
+    SYS_NR_EPOLL_WAIT = 205,
+    SYS_NR_URING_SETUP = 206,
+    SYS_NR_URING_ENTER = 207,
+    SYS_NR_FSTATAT = 208,
+    SYS_NR_SPAWN = 209,
 } syscall_t;
 
 enum mmap_type_t {
@@ -57,8 +78,28 @@ enum mmap_type_t {
     MAP_FIXED = 0x10,
 };
 
+// spawn 的文件操作类型
+enum spawn_type_t {
+    SPAWN_CLOSE, // 关闭 fd
+    SPAWN_DUP2,  // 将 fd 复制到 newfd
+    SPAWN_OPEN,  // 打开文件到 fd
+};
+
+// spawn 的文件操作，子进程执行程序之前依次执行
+typedef struct spawn_action_t {
+    int type;       // 操作类型
+    fd_t fd;        // 文件描述符
+    fd_t newfd;     // dup2 的新描述符
+    char *filename; // open 的文件名
+    int flags;      // open 的标志
+    int mode;       // open 的权限
+} spawn_action_t;
+
 u32 test();
 pid_t fork();
+pid_t vfork();
+pid_t spawn(char *filename, char *argv[], char *envp[],
+            spawn_action_t *actions, int count);
 void exit(int status);
 pid_t waitpid(pid_t pid, int32 *status);
 void yield();
@@ -78,8 +119,25 @@ fd_t dup2(fd_t oldfd, fd_t newfd);
 int pipe(fd_t pipefd[2]);
 int read(fd_t fd, char *buf, int len);
 int write(fd_t fd, char *buf, int len);
+int pread(fd_t fd, char *buf, int len, off_t offset);
+int pwrite(fd_t fd, char *buf, int len, off_t offset);
+int readv(fd_t fd, iovec_t *iov, int iovcnt);
+int writev(fd_t fd, iovec_t *iov, int iovcnt);
+int sendfile(fd_t out_fd, fd_t in_fd, off_t *offset, int count);
+int splice(fd_t in_fd, off_t *in_offset, fd_t out_fd, off_t *out_offset,
+           int count, int flags);
 int lseek(fd_t fd, off_t offset, int whence);
+int fcntl(fd_t fd, int cmd, int arg);
+int poll(pollfd_t *fds, int nfds, int timeout);
+int select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds,
+           int timeout);
+fd_t epoll_create(int size);
+int epoll_ctl(fd_t epfd, int op, fd_t fd, epoll_event_t *event);
+int epoll_wait(fd_t epfd, epoll_event_t *events, int maxevents, int timeout);
+fd_t uring_setup(u32 entries, uring_params_t *params);
+int uring_enter(fd_t fd, u32 to_submit);
 int readdir(fd_t fd, void *dir, int count);
+int getdents(fd_t fd, void *dirp, u32 count);
 char *getcwd(char *buf, size_t size);
 int chdir(char *pathname);
 int chroot(char *pathname);
@@ -87,7 +145,7 @@ int mkdir(char *pathname, int mode);
 int rmdir(char *pathname);
 int link(char *oldname, char *newname);
 int unlink(char *filename);
-int mount(char *devname, char *dirname, int flags);
+int mount(char *devname, char *dirname, char *type, int flags);
 int umount(char *target);
 int mknod(char *filename, int mode, int dev);
 time_t time();
@@ -95,6 +153,7 @@ mode_t umask(mode_t mask);
 void clear();
 int stat(char *filename, stat_t *statbuf);
 int fstat(fd_t fd, stat_t *statbuf);
+int fstatat(fd_t dirfd, char *filename, stat_t *statbuf);
 
 int mkfs(char *devname, int icount);
 
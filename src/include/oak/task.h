@@ -30,6 +30,7 @@ typedef struct task_t {
     u32 priority;                       // priority
     int ticks;                          // left jiffies
     u32 jiffies;                        // jiffies last ran
+    u32 runtime;                        // jiffies ran in total
     char name[TASK_NAME_LEN];           // task name
     u32 uid;                            // user id
     u32 gid;                            // gid
@@ -37,6 +38,8 @@ typedef struct task_t {
     u32 ppid;                           // task father id
     u32 pde;                            // pde
     struct bitmap_t *vmap;              // virtual memory map
+    list_t mmaps;                       // memory mapping areas
+    struct task_t *vfork;               // parent lending memory, by vfork
     u32 text;                           // code section address
     u32 data;                           // data section address
     u32 end;                            // program end address
@@ -92,9 +95,15 @@ typedef struct intr_frame_t {
     u32 ss;
 } intr_frame_t;
 
+struct spawn_action_t;
+
 task_t *running_task();
 void schedule();
 pid_t task_fork();
+pid_t task_vfork();
+pid_t task_spawn(char *filename, char *argv[], char *envp[],
+                 struct spawn_action_t *actions, int count);
+void task_vfork_exec();
 void task_exit(int status);
 pid_t task_waitpid(pid_t pid, int32 *status);
 void task_yield();
@@ -47,4 +47,10 @@ typedef enum std_fd_t { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO } std_fd_t;
 
 typedef int32 off_t; // file offset
 
+// buffer for vectored I/O
+typedef struct iovec_t {
+    void *iov_base; // buffer address
+    size_t iov_len; // buffer length
+} iovec_t;
+
 #endif // DEBUG
@@ -0,0 +1,70 @@
+#ifndef OAK_URING_H
+#define OAK_URING_H
+
+#include <oak/types.h>
+
+#define URING_MAX_ENTRIES 128 // 提交队列最大长度
+
+// 提交的操作
+enum uring_op_t {
+    URING_OP_NOP,   // 空操作
+    URING_OP_READ,  // 读文件
+    URING_OP_WRITE, // 写文件
+    URING_OP_OPEN,  // 打开文件
+    URING_OP_CLOSE, // 关闭文件
+    URING_OP_FSYNC, // 将文件写回磁盘
+};
+
+// 提交队列项
+typedef struct uring_sqe_t {
+    u32 opcode;   // 操作
+    fd_t fd;      // 文件描述符
+    u32 addr;     // 读写缓冲或打开的路径
+    u32 len;      // 读写的字节数
+    off_t offset; // 读写偏移，EOF 表示使用并更新文件偏移
+    int flags;    // 打开文件的标记
+    int mode;     // 创建文件的权限
+    u32 data;     // 用户数据，原样放入完成队列项
+} uring_sqe_t;
+
+// 完成队列项
+typedef struct uring_cqe_t {
+    u32 data; // 提交队列项的用户数据
+    int res;  // 操作的返回值
+} uring_cqe_t;
+
+/*
+ *  与用户共享的环形队列，位于映射区域的开头
+ *
+ *  下标一直递增，取模长度得到数组下标。提交队列由用户写入 sq_tail，
+ *  内核写入 sq_head；完成队列由内核写入 cq_tail，用户写入 cq_head
+ */
+typedef struct uring_ring_t {
+    u32 sq_head;    // 内核下一个处理的提交队列项
+    u32 sq_tail;    // 用户下一个写入的提交队列项
+    u32 cq_head;    // 用户下一个读取的完成队列项
+    u32 cq_tail;    // 内核下一个写入的完成队列项
+    u32 sq_entries; // 提交队列长度
+    u32 cq_entries; // 完成队列长度
+} uring_ring_t;
+
+// uring_setup 返回映射区域的布局
+typedef struct uring_params_t {
+    u32 sq_entries; // 提交队列长度
+    u32 cq_entries; // 完成队列长度
+    u32 sq_off;     // 提交队列项数组的偏移
+    u32 cq_off;     // 完成队列项数组的偏移
+    u32 size;       // 需要映射的字节数
+} uring_params_t;
+
+// 内核中的 uring 对象
+typedef struct uring_t {
+    uring_ring_t *ring; // 共享的队列，内核页
+    uring_sqe_t *sqes;  // 提交队列项数组
+    uring_cqe_t *cqes;  // 完成队列项数组
+    u32 sq_entries;     // 提交队列长度，不使用共享队列中用户可写的值
+    u32 cq_entries;     // 完成队列长度
+    u32 pages;          // 共享的页数
+} uring_t;
+
+#endif // !OAK_URING_H
@@ -1,126 +1,72 @@
 /*
- *  该文件包含 `kmalloc` 和 `kfree` 两个用于内核堆内存管理的函数。这两个函数的
- *  实现依赖于数据结构 `arena_t`。
+ *  该文件包含 `kmalloc` 和 `kfree` 两个用于内核堆内存管理的函数。
  *
- *  在一页中，内存会被分成大小相等的若干块。在页开始的位置会有一个 `arena_t`，
- *  它记录了该页内存的块大小，剩余空闲块数量等信息。`arena_t` 中有嵌套数据结构
- *  `arena_descriptor_t`，它存储了该页的块大小，块总数，以及链表结点。
+ *  不大于 1024 字节的内存从 7 种不同大小的 slab 缓存中分配，空闲块的链表保存
+ *  在块之外，见 slab.c。
  *
- *  系统维护一个 arena 描述符数组，该数组对应 7 种不同大小的块。
+ *  更大的内存直接分配连续页，在页开始的位置会有一个 `arena_t`，它记录了页数。
  **/
 
 #include <oak/arena.h>
 #include <oak/assert.h>
-#include <oak/list.h>
 #include <oak/memory.h>
 #include <oak/oak.h>
+#include <oak/proc.h>
+#include <oak/slab.h>
+#include <oak/stdio.h>
 #include <oak/stdlib.h>
 #include <oak/string.h>
 #include <oak/types.h>
-// extern u32 free_pages;
-static arena_descriptor_t descriptors[DESC_COUNT];
+
+static kmem_cache_t *caches[DESC_COUNT];
+static u32 large_pages; // 大于 1024 字节的分配占用的页数
 
 /*
- *  @brief  初始化 arena 描述符数组
+ *  @brief  创建各种大小的缓存
  **/
 void arena_init() {
     u32 block_size = 16;
+    char name[SLAB_NAME_LEN];
     for (size_t i = 0; i < DESC_COUNT; i++) {
-        arena_descriptor_t *desc = &descriptors[i];
-        desc->block_size = block_size;
-        desc->total_block = (PAGE_SIZE - sizeof(arena_t)) / block_size;
-        list_init(&desc->free_list);
+        sprintf(name, "kmalloc-%d", block_size);
+        caches[i] = kmem_cache_create(name, block_size, NULL);
         block_size <<= 1;
     }
 }
 
-/*
- *  @brief  获取 arena 中第 @a idx 块的地址
- *  @param  arena  arena
- *  @param  idx  块索引
- **/
-static void *get_arena_block(arena_t *arena, u32 idx) {
-    assert(arena->desc->total_block > idx);
-    void *addr = (void *)(arena + 1);
-    u32 gap = idx * arena->desc->block_size;
-    return addr + gap;
-}
-
-/*
- *  @brief  获取块所属的 arena 的地址
- *  @param  block  空闲块链表的一个结点
- *
- *  实际上是获取当前页的地址
- **/
-static arena_t *get_block_arena(block_t *block) {
-    return (arena_t *)((u32)block & 0xfffff000);
-}
-
 /*
  *  @brief  堆内存分配
  *  @param  size  内存大小，单位为字节
  **/
 void *kmalloc(size_t size) {
-    arena_descriptor_t *desc = NULL;
-    arena_t *arena;
-    block_t *block;
-    char *addr;
-
     // 大于 1024 字节
     if (size > 1024) {
         u32 asize = size + sizeof(arena_t);
         u32 count = div_round_up(asize, PAGE_SIZE);
 
-        arena = (arena_t *)alloc_kpage(count);
-        memset(arena, 0, count * PAGE_SIZE);
+        arena_t *arena;
+        if (count == 1) {
+            arena = (arena_t *)alloc_zero_kpage();
+        } else {
+            arena = (arena_t *)alloc_kpage(count);
+            memset(arena, 0, count * PAGE_SIZE);
+        }
 
-        arena->large = true;
-        arena->count = count;
-        arena->desc = NULL;
         arena->magic = OAK_MAGIC;
+        arena->count = count;
+        large_pages += count;
 
-        addr = (char *)((u32)arena + sizeof(arena_t));
-        return addr;
+        return (void *)(arena + 1);
     }
 
-    // 小于等于 1024 字节，在描述符表中寻找对应的描述符
+    // 小于等于 1024 字节，寻找能放下的最小缓存
     for (size_t i = 0; i < DESC_COUNT; i++) {
-        desc = &descriptors[i];
-        if (desc->block_size >= size) {
-            break;
+        if (caches[i]->size >= size) {
+            return kmem_cache_alloc(caches[i]);
         }
     }
-    assert(desc != NULL);
-
-    // 描述符的空闲块列表为空
-    if (list_empty(&desc->free_list)) {
-        arena = (arena_t *)alloc_kpage(1);
-        memset(arena, 0, PAGE_SIZE);
-
-        // 初始化该页的 arena
-        arena->desc = desc;
-        arena->large = false;
-        arena->count = desc->total_block;
-        arena->magic = OAK_MAGIC;
-
-        // 将该页的所有块加入到空闲块列表中
-        for (size_t i = 0; i < desc->total_block; i++) {
-            block = get_arena_block(arena, i);
-            assert(!list_search(&arena->desc->free_list, block));
-            list_push(&arena->desc->free_list, block);
-            assert(list_search(&arena->desc->free_list, block));
-        }
-    }
-
-    // BUG: 从列表中取出一个空闲块返回，但不能保证程序不会破坏该链表结点保存的
-    // 信息，而一旦被破坏，该块将再也找不到。
-    block = list_pop(&desc->free_list);
-
-    arena = get_block_arena(block);
-    assert(arena->magic == OAK_MAGIC && !arena->large);
-
-    arena->count--;
-    return block;
+    panic("kmalloc size %d error", size);
+    return NULL; // no use
 }
 
 /*
@@ -130,30 +76,18 @@ void *kmalloc(size_t size) {
 void kfree(void *ptr) {
     assert(ptr);
 
-    block_t *block = (block_t *)ptr;
-    arena_t *arena = get_block_arena(block);
-
-    assert(arena->large == 1 || arena->large == 0);
-    assert(arena->magic == OAK_MAGIC);
-
     // 大于 1024 字节，释放连续页
-    if (arena->large) {
+    arena_t *arena = (arena_t *)((u32)ptr & 0xfffff000);
+    if (arena->magic == OAK_MAGIC && ptr == arena + 1) {
+        large_pages -= arena->count;
+        arena->magic = 0;
         free_kpage((u32)arena, arena->count);
         return;
     }
 
-    // BUG: 链表信息可能被破坏
-    list_push(&arena->desc->free_list, block);
-    arena->count++;
+    kmem_cache_free(kmem_cache_find(ptr), ptr);
+}
 
-    // 若空闲块数量与描述符的块总数相等，则释放该页内存
-    if (arena->count == arena->desc->total_block) {
-        for (size_t i = 0; i < arena->desc->total_block; i++) {
-            block = get_arena_block(arena, i);
-            assert(list_search(&arena->desc->free_list, block));
-            list_remove(block);
-            assert(!list_search(&arena->desc->free_list, block));
-        }
-        free_kpage((u32)arena, 1);
-    }
+void arena_show(proc_buf_t *pb) {
+    proc_printf(pb, "large     %u\n", large_pages);
 }
@@ -5,27 +5,31 @@
 #include <oak/list.h>
 #include <oak/memory.h>
 #include <oak/mutex.h>
+#include <oak/proc.h>
 #include <oak/string.h>
 #include <oak/task.h>
 #include <oak/types.h>
 
 #define HASH_COUNT 31
 
-static buffer_t *buffer_start = (buffer_t *)KERNEL_BUFFER_MEM;
+static buffer_t *buffer_start;
 static u32 buffer_count = 0;
 
-static buffer_t *buffer_ptr = (buffer_t *)KERNEL_BUFFER_MEM;
+static buffer_t *buffer_ptr;
 
-static void *buffer_data =
-    (void *)(KERNEL_BUFFER_MEM + KERNEL_BUFFER_SIZE - BLOCK_SIZE);
+static void *buffer_data;
 
 static list_t free_list;              // 缓存链表，被释放的块
 static list_t wait_list;              // 等待进程链表
 static list_t hash_table[HASH_COUNT]; // 缓存哈希表
 
+static u32 buffer_hits;   // bread 命中有效缓冲的次数
+static u32 buffer_misses; // bread 从设备读取的次数
+static u32 buffer_writes; // 写回设备的次数
+
 u32 hash(dev_t dev, idx_t block) { return (dev ^ block) % HASH_COUNT; }
 
-static buffer_t *get_from_hash_table(dev_t dev, idx_t block) {
+static buffer_t *hash_find(dev_t dev, idx_t block) {
     u32 idx = hash(dev, block);
     list_t *list = &hash_table[idx];
     buffer_t *bf = NULL;
@@ -39,6 +43,11 @@ static buffer_t *get_from_hash_table(dev_t dev, idx_t block) {
         }
     }
 
+    return bf;
+}
+
+static buffer_t *get_from_hash_table(dev_t dev, idx_t block) {
+    buffer_t *bf = hash_find(dev, block);
     if (!bf) {
         return NULL;
     }
@@ -74,6 +83,7 @@ static buffer_t *get_new_buffer() {
         bf->count = 0;
         bf->dirty = false;
         bf->valid = false;
+        bf->delay = false;
         lock_init(&bf->lock);
         buffer_count++;
         buffer_ptr++;
@@ -94,7 +104,10 @@ static buffer_t *get_free_buffer() {
 
         if (!list_empty(&free_list)) {
             bf = element_entry(buffer_t, rnode, list_popback(&free_list));
-            hash_remove(bf);
+            // 丢弃的延迟缓冲不在哈希表中
+            if (bf->dev != EOF) {
+                hash_remove(bf);
+            }
             bf->valid = false;
             return bf;
         }
@@ -124,12 +137,14 @@ buffer_t *bread(dev_t dev, idx_t block) {
     buffer_t *bf = getblk(dev, block);
     assert(bf != NULL);
     if (bf->valid) {
+        buffer_hits++;
         return bf;
     }
 
     lock_acquire(&bf->lock);
 
     if (!bf->valid) {
+        buffer_misses++;
         device_request(bf->dev, bf->data, BLOCK_SECS, bf->block * BLOCK_SECS, 0,
                        REQ_READ);
         bf->dirty = false;
@@ -142,10 +157,12 @@ buffer_t *bread(dev_t dev, idx_t block) {
 
 void bwrite(buffer_t *bf) {
     assert(bf);
-    if (!bf->dirty) {
+    // 延迟分配的缓冲还没有对应的磁盘块
+    if (!bf->dirty || bf->delay) {
         return;
     }
 
+    buffer_writes++;
     device_request(bf->dev, bf->data, BLOCK_SECS, bf->block * BLOCK_SECS, 0,
                    REQ_WRITE);
     bf->dirty = false;
@@ -177,9 +194,104 @@ void brelse(buffer_t *bf) {
     }
 }
 
+// 获取一个尚未分配磁盘块的缓冲，用于延迟分配
+// 缓冲内容清零，在绑定磁盘块之前不会被写回
+buffer_t *getblk_delay(dev_t dev) {
+    buffer_t *bf = get_free_buffer();
+    assert(bf->count == 0);
+    assert(bf->dirty == 0);
+
+    bf->count = 1;
+    bf->dev = dev;
+    bf->block = 0;
+    bf->delay = true;
+    bf->valid = true;
+    memset(bf->data, 0, BLOCK_SIZE);
+    return bf;
+}
+
+// 为延迟分配的缓冲绑定磁盘块
+void bassign(buffer_t *bf, idx_t block) {
+    assert(bf->delay);
+
+    // 块刚被分配，哈希表中可能还有其被释放前的旧缓冲
+    buffer_t *old = get_from_hash_table(bf->dev, block);
+    if (old) {
+        assert(old->count == 0);
+        hash_remove(old);
+        old->dev = EOF;
+        old->valid = false;
+        old->dirty = false;
+        list_push(&free_list, &old->rnode);
+    }
+
+    bf->delay = false;
+    bf->block = block;
+    hash_locate(bf);
+}
+
+// 丢弃延迟分配的缓冲，比如文件在写回之前被截断
+void bdiscard(buffer_t *bf) {
+    assert(bf->delay);
+    assert(bf->count == 1);
+
+    bf->delay = false;
+    bf->dirty = false;
+    bf->valid = false;
+    bf->dev = EOF;
+    bf->count = 0;
+
+    list_push(&free_list, &bf->rnode);
+
+    if (!list_empty(&wait_list)) {
+        task_t *task = element_entry(task_t, node, list_popback(&wait_list));
+        task_unblock(task);
+    }
+}
+
+// 数据直接写入设备后，更新高速缓冲中对应的块
+void brefresh(dev_t dev, idx_t block, void *data) {
+    buffer_t *bf = hash_find(dev, block);
+    if (bf && bf->valid) {
+        memcpy(bf->data, data, BLOCK_SIZE);
+    }
+}
+
+void buffer_show(proc_buf_t *pb) {
+    u32 used = 0;
+    u32 dirty = 0;
+    u32 delay = 0;
+    for (buffer_t *bf = buffer_start; bf < buffer_ptr; bf++) {
+        if (bf->count) {
+            used++;
+        }
+        if (bf->dirty) {
+            dirty++;
+        }
+        if (bf->delay) {
+            delay++;
+        }
+    }
+
+    proc_printf(pb, "buffers   %u\n", buffer_count);
+    proc_printf(pb, "used      %u\n", used);
+    proc_printf(pb, "free      %u\n", list_size(&free_list));
+    proc_printf(pb, "dirty     %u\n", dirty);
+    proc_printf(pb, "delay     %u\n", delay);
+    proc_printf(pb, "waiting   %u\n", list_size(&wait_list));
+    proc_printf(pb, "hits      %u\n", buffer_hits);
+    proc_printf(pb, "misses    %u\n", buffer_misses);
+    proc_printf(pb, "writes    %u\n", buffer_writes);
+}
+
 void buffer_init() {
     DEBUGK("buffer_t size is %d\n", sizeof(buffer_t));
 
+    // 高速缓冲的大小由内存大小决定
+    buffer_start = (buffer_t *)kernel_buffer_mem;
+    buffer_ptr = buffer_start;
+    buffer_data = (void *)(kernel_buffer_mem + kernel_buffer_size - BLOCK_SIZE);
+
     list_init(&free_list);
     list_init(&wait_list);
 
@@ -56,6 +56,7 @@ void clock_handler(int vector) {
     assert(task->magic == OAK_MAGIC);
 
     task->jiffies = jiffies;
+    task->runtime++;
     task->ticks--;
     if (!task->ticks) {
         schedule();
@@ -4,6 +4,8 @@
 #include <oak/device.h>
 #include <oak/list.h>
 #include <oak/oak.h>
+#include <oak/proc.h>
+#include <oak/slab.h>
 #include <oak/string.h>
 #include <oak/task.h>
 #include <oak/types.h>
@@ -11,6 +13,7 @@
 #define DEVICE_NR 64 // device amount
 
 static device_t devices[DEVICE_NR];
+static kmem_cache_t *request_cache;
 
 static device_t *get_null_device() {
     for (size_t i = 1; i < DEVICE_NR; i++) {
@@ -77,7 +80,11 @@ void device_init() {
 
         list_init(&device->request_list);
         device->direct = DIRECT_UP;
+        device->reads = 0;
+        device->writes = 0;
+        device->sectors = 0;
     }
+    request_cache = kmem_cache_create("request_t", sizeof(request_t), NULL);
 }
 
 device_t *device_find(int subtype, idx_t idx) {
@@ -100,6 +107,16 @@ device_t *device_get(dev_t dev) {
     return device;
 }
 
+// 统计设备的请求
+static void request_account(device_t *device, u8 count, u32 type) {
+    if (type == REQ_READ) {
+        device->reads++;
+    } else {
+        device->writes++;
+    }
+    device->sectors += count;
+}
+
 static void do_request(request_t *req) {
     DEBUGK("dev %d do request idx %d\n", req->dev, req->idx);
     switch (req->type) {
@@ -144,11 +161,14 @@ void device_request(dev_t dev, void *buf, u8 count, idx_t idx, int flags,
     assert(device->type == DEV_BLOCK);
     idx_t offset = idx + device_ioctl(device->dev, DEV_CMD_SECTOR_START, 0, 0);
 
+    // 分区的请求也计入所在的磁盘
+    request_account(device, count, type);
     if (device->parent) {
         device = device_get(device->parent);
+        request_account(device, count, type);
     }
 
-    request_t *req = kmalloc(sizeof(request_t));
+    request_t *req = kmem_cache_alloc(request_cache);
 
     req->dev = device->dev;
     req->buf = buf;
@@ -176,10 +196,25 @@ void device_request(dev_t dev, void *buf, u8 count, idx_t idx, int flags,
     request_t *nextreq = request_nextreq(device, req);
 
     list_remove(&req->node);
-    kfree(req);
+    kmem_cache_free(request_cache, req);
 
     if (nextreq) {
         assert(nextreq->task->magic == OAK_MAGIC);
         task_unblock(nextreq->task);
     }
 }
+
+void device_show(proc_buf_t *pb) {
+    static char *types[] = {"null", "char", "block"};
+
+    proc_printf(pb, "dev  name      type  parent reads    writes   sectors\n");
+    for (size_t i = 1; i < DEVICE_NR; i++) {
+        device_t *device = &devices[i];
+        if (device->type == DEV_NULL) {
+            continue;
+        }
+        proc_printf(pb, "%-4d %-9s %-5s %-6d %-8u %-8u %u\n", device->dev,
+                    device->name, types[device->type], device->parent,
+                    device->reads, device->writes, device->sectors);
+    }
+}
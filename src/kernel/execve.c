@@ -205,6 +205,17 @@ static void load_segment(inode_t *inode, Elf32_Phdr *phdr) {
     // 需要页的数量
     u32 count = div_round_up(MAX(phdr->p_memsz, phdr->p_filesz), PAGE_SIZE);
 
+    task_t *task = running_task();
+
+    // 只读段从页缓存按需映射，运行同一程序的进程共享物理页
+    if ((phdr->p_flags & PF_W) == 0 && (phdr->p_offset & 0xfff) == 0 &&
+        phdr->p_memsz <= phdr->p_filesz) {
+        assert(vaddr >= USER_EXEC_ADDR &&
+               vaddr + count * PAGE_SIZE <= USER_MMAP_ADDR);
+        mmap_file(vaddr, count * PAGE_SIZE, PROT_READ, inode, phdr->p_offset);
+        goto update;
+    }
+
     for (size_t i = 0; i < count; i++) {
         u32 addr = vaddr + i * PAGE_SIZE;
         assert(addr >= USER_EXEC_ADDR && addr < USER_MMAP_ADDR);
@@ -219,16 +230,19 @@ static void load_segment(inode_t *inode, Elf32_Phdr *phdr) {
 
     // 如果段不可写，则置为只读
     if ((phdr->p_flags & PF_W) == 0) {
+        tlb_batch_t batch;
+        tlb_batch_init(&batch);
         for (size_t i = 0; i < count; i++) {
             u32 addr = vaddr + i * PAGE_SIZE;
             page_entry_t *entry = get_entry(addr, false);
             entry->write = false;
             entry->readonly = true;
-            flush_tlb(addr);
+            tlb_batch_add(&batch, addr);
         }
+        tlb_batch_flush(&batch);
     }
 
-    task_t *task = running_task();
+update:
     if (phdr->p_flags == (PF_R | PF_X)) {
         task->text = vaddr;
     } else if (phdr->p_flags == (PF_R | PF_W)) {
@@ -239,19 +253,24 @@ static void load_segment(inode_t *inode, Elf32_Phdr *phdr) {
 }
 
 static u32 load_elf(inode_t *inode) {
-    link_page(USER_EXEC_ADDR);
+    // 文件头读到内核页中，用户空间的页留给按需映射的段
+    u32 page = alloc_kpage(1);
+    u32 entry = EOF;
 
     int n = 0;
     // 读取 ELF 文件头
-    n = inode_read(inode, (char *)USER_EXEC_ADDR, sizeof(Elf32_Ehdr), 0);
+    n = inode_read(inode, (char *)page, sizeof(Elf32_Ehdr), 0);
     assert(n == sizeof(Elf32_Ehdr));
 
-    Elf32_Ehdr *ehdr = (Elf32_Ehdr *)USER_EXEC_ADDR;
+    Elf32_Ehdr *ehdr = (Elf32_Ehdr *)page;
     if (!elf_validate(ehdr))
-        return EOF;
+        goto rollback;
 
     // 读取程序段头表
-    Elf32_Phdr *phdr = (Elf32_Phdr *)(USER_EXEC_ADDR + sizeof(Elf32_Ehdr));
+    if (sizeof(Elf32_Ehdr) + ehdr->e_phnum * ehdr->e_phentsize > PAGE_SIZE)
+        goto rollback;
+
+    Elf32_Phdr *phdr = (Elf32_Phdr *)(page + sizeof(Elf32_Ehdr));
     n = inode_read(inode, (char *)phdr, ehdr->e_phnum * ehdr->e_phentsize,
                    ehdr->e_phoff);
 
@@ -262,8 +281,11 @@ static u32 load_elf(inode_t *inode) {
         load_segment(inode, ptr);
         ptr++;
     }
+    entry = ehdr->e_entry;
 
-    return ehdr->e_entry;
+rollback:
+    free_kpage(page, 1);
+    return entry;
 }
 
 static int count_argv(char *argv[]) {
@@ -348,6 +370,9 @@ static u32 copy_argv_envp(char *filename, char *argv[], char *envp[]) {
 
     assert((u32)ktop > pages);
 
+    // 参数已在内核中，vfork 的子进程此后使用自己的地址空间
+    task_vfork_exec();
+
     // 将参数和环境变量拷贝到用户栈
     len = (pages_end - (u32)ktop);
     utop = (char *)(USER_STACK_TOP - len);
@@ -368,8 +393,8 @@ int sys_execve(char *filename, char *argv[], char *envp[]) {
     if (!inode)
         goto rollback;
 
-    // 不是常规文件
-    if (!ISFILE(inode->desc->mode))
+    // 不是 MINIX 文件系统上的常规文件
+    if (inode->fop != &minix_file_op || !ISFILE(inode->desc->mode))
         goto rollback;
 
     // 文件不可执行
@@ -386,6 +411,9 @@ int sys_execve(char *filename, char *argv[], char *envp[]) {
     task->end = USER_EXEC_ADDR;
     sys_brk(USER_EXEC_ADDR);
 
+    // 解除原程序的内存映射
+    mmap_exit();
+
     // 加载程序
     u32 entry = load_elf(inode);
     if (entry == EOF)
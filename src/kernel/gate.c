@@ -27,6 +27,20 @@ extern fd_t sys_dup2();
 extern int sys_pipe();
 extern int sys_read();
 extern int sys_write();
+extern int sys_pread();
+extern int sys_pwrite();
+extern int sys_readv();
+extern int sys_writev();
+extern int sys_sendfile();
+extern int sys_fcntl();
+extern int sys_poll();
+extern int sys_select();
+extern int sys_epoll_create();
+extern int sys_epoll_ctl();
+extern int sys_epoll_wait();
+extern int sys_uring_setup();
+extern int sys_uring_enter();
+extern int sys_splice();
 extern int sys_lseek();
 extern int sys_chdir();
 extern int sys_chroot();
@@ -35,6 +49,8 @@ extern time_t sys_readdir();
 extern void console_clear();
 extern int sys_stat();
 extern int sys_fstat();
+extern int sys_fstatat();
+extern int sys_getdents();
 extern int sys_mknod();
 extern int sys_mount();
 extern int sys_umount();
@@ -51,6 +67,7 @@ void syscall_check(u32 nr) {
     if (nr >= SYSCALL_SIZE) {
         panic("syscall nr error!");
     }
+    interrupt_count[0x80]++;
 }
 
 static void sys_default() { panic("syscall not implemented!"); }
@@ -86,6 +103,8 @@ void syscall_init() {
 
     syscall_table[SYS_NR_EXIT] = task_exit;
     syscall_table[SYS_NR_FORK] = task_fork;
+    syscall_table[SYS_NR_VFORK] = task_vfork;
+    syscall_table[SYS_NR_SPAWN] = task_spawn;
     syscall_table[SYS_NR_WAITPID] = task_waitpid;
 
     syscall_table[SYS_NR_EXECVE] = sys_execve;
@@ -107,8 +126,23 @@ void syscall_init() {
 
     syscall_table[SYS_NR_READ] = sys_read;
     syscall_table[SYS_NR_WRITE] = sys_write;
+    syscall_table[SYS_NR_PREAD] = sys_pread;
+    syscall_table[SYS_NR_PWRITE] = sys_pwrite;
+    syscall_table[SYS_NR_READV] = sys_readv;
+    syscall_table[SYS_NR_WRITEV] = sys_writev;
+    syscall_table[SYS_NR_SENDFILE] = sys_sendfile;
+    syscall_table[SYS_NR_FCNTL] = sys_fcntl;
+    syscall_table[SYS_NR_POLL] = sys_poll;
+    syscall_table[SYS_NR_SELECT] = sys_select;
+    syscall_table[SYS_NR_EPOLL_CREATE] = sys_epoll_create;
+    syscall_table[SYS_NR_EPOLL_CTL] = sys_epoll_ctl;
+    syscall_table[SYS_NR_EPOLL_WAIT] = sys_epoll_wait;
+    syscall_table[SYS_NR_URING_SETUP] = sys_uring_setup;
+    syscall_table[SYS_NR_URING_ENTER] = sys_uring_enter;
+    syscall_table[SYS_NR_SPLICE] = sys_splice;
     syscall_table[SYS_NR_LSEEK] = sys_lseek;
     syscall_table[SYS_NR_READDIR] = sys_readdir;
+    syscall_table[SYS_NR_GETDENTS] = sys_getdents;
 
     syscall_table[SYS_NR_MKDIR] = sys_mkdir;
     syscall_table[SYS_NR_RMDIR] = sys_rmdir;
@@ -132,6 +166,7 @@ void syscall_init() {
 
     syscall_table[SYS_NR_STAT] = sys_stat;
     syscall_table[SYS_NR_FSTAT] = sys_fstat;
+    syscall_table[SYS_NR_FSTATAT] = sys_fstatat;
 
     syscall_table[SYS_NR_MKNOD] = sys_mknod;
 
@@ -1,6 +1,7 @@
 [bits 32]
 
 extern handler_table
+extern interrupt_count
 
 section .text
 
@@ -23,6 +24,7 @@ interrupt_entry:
 	pusha
 	
 	mov eax, [esp + 12 * 4] ; move first parameter of macro to eax
+	inc dword [interrupt_count + eax * 4]
 
 	push eax
 	call [handler_table + eax * 4]
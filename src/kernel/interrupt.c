@@ -4,6 +4,7 @@
 #include <oak/interrupt.h>
 #include <oak/io.h>
 #include <oak/printk.h>
+#include <oak/proc.h>
 #include <oak/stdlib.h>
 #include <oak/types.h>
 
@@ -20,6 +21,7 @@ gate_t idt[IDT_SIZE];
 pointer_t idt_ptr;
 
 handler_t handler_table[IDT_SIZE];
+u32 interrupt_count[IDT_SIZE];
 extern handler_t handler_entry_table[ENTRY_SIZE];
 extern void syscall_handler();
 extern void page_fault();
@@ -133,6 +135,26 @@ void exception_handler(int vector, u32 edi, u32 esi, u32 ebp, u32 esp, u32 ebx,
     hang();
 }
 
+void interrupt_show(proc_buf_t *pb) {
+    proc_printf(pb, "vector count      name\n");
+    for (size_t i = 0; i < IDT_SIZE; i++) {
+        u32 count = interrupt_count[i];
+        if (!count) {
+            continue;
+        }
+        if (i < 22) {
+            proc_printf(pb, "0x%02x   %-10u %s\n", i, count, messages[i]);
+        } else if (i >= IRQ_MASTER_NR && i < IRQ_MASTER_NR + 16) {
+            proc_printf(pb, "0x%02x   %-10u IRQ %d\n", i, count,
+                        i - IRQ_MASTER_NR);
+        } else if (i == 0x80) {
+            proc_printf(pb, "0x%02x   %-10u system call\n", i, count);
+        } else {
+            proc_printf(pb, "0x%02x   %-10u\n", i, count);
+        }
+    }
+}
+
 // 初始化中断控制器
 void pic_init() {
     // master chip init
@@ -5,6 +5,7 @@
 #include <oak/interrupt.h>
 #include <oak/io.h>
 #include <oak/mutex.h>
+#include <oak/poll.h>
 #include <oak/task.h>
 #include <oak/types.h>
 
@@ -224,7 +225,7 @@ static char keymap[][4] = {
 };
 
 static lock_t lock;
-static task_t *waiter;
+static wait_queue_t wait;
 
 #define BUFFER_SIZE 64
 static char buf[BUFFER_SIZE];
@@ -352,24 +353,35 @@ void keyboard_handler(int vector) {
 
     fifo_put(&fifo, ch);
 
-    if (waiter != NULL) {
-        task_unblock(waiter);
-        waiter = NULL;
+    wait_wakeup(&wait);
+}
+
+int keyboard_ioctl(void *dev, int cmd, void *args, int flags) {
+    switch (cmd) {
+    case DEV_CMD_POLL:
+        *(wait_queue_t **)args = &wait;
+        return fifo_empty(&fifo) ? 0 : POLLIN;
+    default:
+        return EOF;
     }
 }
 
-u32 keyboard_read(void *dev, char *buf, u32 count) {
+u32 keyboard_read(void *dev, char *buf, u32 count, idx_t idx, int flags) {
     lock_acquire(&lock);
     int nr = 0;
     while (nr < count) {
         while (fifo_empty(&fifo)) {
-            waiter = running_task();
-            task_block(waiter, NULL, TASK_BLOCKED);
+            // 非阻塞时返回已经读到的字符
+            if (flags & DEV_NONBLOCK) {
+                goto rollback;
+            }
+            wait_sleep(&wait);
         }
         buf[nr++] = fifo_get(&fifo);
     }
+rollback:
     lock_release(&lock);
-    return count;
+    return nr ? nr : EOF;
 }
 
 void keyboard_init() {
@@ -380,12 +392,12 @@ void keyboard_init() {
 
     fifo_init(&fifo, buf, BUFFER_SIZE);
     lock_init(&lock);
-    waiter = NULL;
+    wait_init(&wait);
     set_leds();
 
     set_interrupt_handler(IRQ_KEYBOARD, keyboard_handler);
     set_interrupt_mask(IRQ_KEYBOARD, true);
 
-    device_install(DEV_CHAR, DEV_KEYBOARD, NULL, "keyboard", 0, NULL,
+    device_install(DEV_CHAR, DEV_KEYBOARD, NULL, "keyboard", 0, keyboard_ioctl,
                    keyboard_read, NULL);
 }
@@ -1,29 +1,35 @@
+#include <oak/arena.h>
 #include <oak/assert.h>
 #include <oak/bitmap.h>
 #include <oak/debug.h>
 #include <oak/fs.h>
+#include <oak/interrupt.h>
 #include <oak/memory.h>
 #include <oak/multiboot2.h>
 #include <oak/oak.h>
 #include <oak/printk.h>
+#include <oak/proc.h>
+#include <oak/slab.h>
 #include <oak/stdlib.h>
 #include <oak/string.h>
 #include <oak/syscall.h>
 #include <oak/task.h>
 #include <oak/types.h>
+#include <oak/uring.h>
 
 #define ZONE_VALID 1    // valid area of ards
 #define ZONE_RESERVED 2 // invalid area of ards
 
-#define IDX(addr) ((u32)addr >> 12)            // page index
-#define DIDX(addr) (((u32)addr >> 22) & 0x3ff) // page directory index
-#define TIDX(addr) (((u32)addr >> 12) & 0x3ff) // page table index
-#define PAGE(idx) ((u32)idx << 12)
+#define IDX(addr) ((u32)(addr) >> 12)            // page index
+#define DIDX(addr) (((u32)(addr) >> 22) & 0x3ff) // page directory index
+#define TIDX(addr) (((u32)(addr) >> 12) & 0x3ff) // page table index
+#define PAGE(idx) ((u32)(idx) << 12)
 #define ASSERT_PAGE(addr) assert((addr & 0xfff) == 0)
 
 #define KERNEL_MAP_BITS 0x6000 // array address of kernel virtual memory
 
 #define PDE_MASK 0xffc00000
+#define TABLE_SIZE 0x400000 // memory mapped by one page table
 
 static u32 KERNEL_PAGE_TABLE[] = {0x2000, 0x3000, 0x4000, 0x5000};
 
@@ -39,17 +45,84 @@ typedef struct ards_t {
     u32 type;
 } _packed ards_t;
 
+#define ZONE_NR 8 // most usable memory zones
+
+// 可用的物理内存区域，以页为单位
+typedef struct zone_t {
+    u32 start; // first page
+    u32 end;   // page after the last
+} zone_t;
+
+static zone_t zones[ZONE_NR];
+static u32 zone_count;
+
 static u32 memory_base = 0;
 static u32 memory_size = 0;
 static u32 total_pages = 0;
 static u32 free_pages = 0;
 
+u32 kernel_buffer_mem;
+u32 kernel_buffer_size;
+u32 kernel_ramdisk_mem;
+u32 kernel_ramdisk_size;
+
 #define used_pages (total_pages - free_pages)
 
+static u32 fault_count;    // 缺页异常次数
+static u32 cow_count;      // 写时复制的次数
+static u32 file_count;     // 文件映射缺页的次数
+static u32 zero_map_count; // 映射共享零页的次数
+static u32 around_count;   // 缺页时预先处理相邻页的次数
+static u32 around_pages;   // 预先处理的相邻页数
+static u32 table_copies;   // 写时复制页表的次数
+static u32 tlb_pages;      // 逐页无效化 TLB 的页数
+static u32 tlb_flushes;    // 批量无效化时刷新全部 TLB 的次数
+
+// 共享零页，匿名页的读缺页映射到此页，第一次写入时再分配私有页。
+// 零页不计入引用计数，映射和解除映射都不修改 memory_map
+static u32 zero_page;
+
+/*
+ *  @brief  记录一块可用内存
+ *  @param  base  起始地址
+ *  @param  size  大小
+ *
+ *  只使用 1M 到 MEMORY_SIZE_MAX 之间按页对齐的部分，区域按地址排序
+ */
+static void zone_add(u64 base, u64 size) {
+    u64 end = base + size;
+    if (base < MEMORY_BASE) {
+        base = MEMORY_BASE;
+    }
+    if (end > MEMORY_SIZE_MAX) {
+        end = MEMORY_SIZE_MAX;
+    }
+    if (base >= end) {
+        return;
+    }
+
+    u32 start = IDX((u32)base + PAGE_SIZE - 1);
+    u32 stop = IDX((u32)end);
+    if (start >= stop) {
+        return;
+    }
+    if (zone_count == ZONE_NR) {
+        DEBUGK("Too many memory zones, ignore 0x%p\n", PAGE(start));
+        return;
+    }
+
+    size_t i = zone_count++;
+    for (; i > 0 && zones[i - 1].start > start; i--) {
+        zones[i] = zones[i - 1];
+    }
+    zones[i].start = start;
+    zones[i].end = stop;
+}
+
 /* Check memory status
  *
- * This function check the result of `detecting_memory` in loader.asm and store
- * the value about memory status in four static variable
+ * This function check the result of `detecting_memory` in loader.asm and
+ * record all usable memory zones
  *
  * @param magic Magic number to compatible with grub
  * @param addr Address of ards_count
@@ -61,11 +134,9 @@ void memory_init(u32 magic, u32 addr) {
         count = *(u32 *)addr;
         ards_t *ptr = (ards_t *)(addr + 4); // points to ards_buffer
 
-        // find out the largest memory block
         for (size_t i = 0; i < count; i++, ptr++) {
-            if (ptr->type == ZONE_VALID && ptr->size > memory_size) {
-                memory_base = (u32)ptr->base;
-                memory_size = (u32)ptr->size;
+            if (ptr->type == ZONE_VALID) {
+                zone_add(ptr->base, ptr->size);
             }
         }
     } else if (magic == MULTIBOOT2_MAGIC) {
@@ -87,9 +158,8 @@ void memory_init(u32 magic, u32 addr) {
             DEBUGK("Memory base 0x%p size 0x%p type %d\n", (u32)entry->addr,
                    (u32)entry->len, (u32)entry->type);
             count++;
-            if (entry->type == ZONE_VALID && entry->len > memory_size) {
-                memory_base = (u32)entry->addr;
-                memory_size = (u32)entry->len;
+            if (entry->type == ZONE_VALID) {
+                zone_add(entry->addr, entry->len);
             }
             entry = (multi_mmap_entry_t *)((u32)entry + mtag->entry_size);
         }
@@ -97,24 +167,345 @@ void memory_init(u32 magic, u32 addr) {
         panic("Memory init magic unknown 0x%p\n", magic);
     }
 
-    assert(memory_base == MEMORY_BASE);
-    assert((memory_size & 0xfff) == 0); // 要求内存大小按页对齐
-
-    total_pages = IDX(memory_size) + IDX(MEMORY_BASE);
-    free_pages = IDX(memory_size);
-
-    if (memory_size < KERNEL_MEMORY_SIZE) {
+    // 内核内存必须是从 1M 开始的连续内存
+    if (!zone_count || zones[0].start != IDX(MEMORY_BASE) ||
+        zones[0].end < IDX(KERNEL_MEMORY_SIZE)) {
         panic("System memory is too small, at least %dM needed\n",
               KERNEL_MEMORY_SIZE / MEMORY_BASE);
     }
+
+    memory_base = MEMORY_BASE;
+    total_pages = zones[zone_count - 1].end;
+    for (size_t i = 0; i < zone_count; i++) {
+        DEBUGK("Memory zone 0x%p - 0x%p\n", PAGE(zones[i].start),
+               PAGE(zones[i].end));
+        free_pages += zones[i].end - zones[i].start;
+    }
+    memory_size = PAGE(free_pages);
 }
 
 static u32 start_page = 0;   // start location of available physical memory
 static u8 *memory_map;       // physical memory array
 static u32 memory_map_pages; // pages amount for managing
 
+/*
+ *  伙伴系统，管理内核映射区之外的物理页
+ *
+ *  空闲页按 2^order 页大小的块组织，块的起始页按块大小对齐。分配时从不小于
+ *  所需阶的最小空闲块中分裂，释放时与同阶的空闲伙伴合并。块的首页记录块的阶，
+ *  并通过结点挂在对应阶的空闲链表中。memory_map 仍然是每页的引用计数。
+ *
+ *  单页分配最频繁，最近释放的单页保存在 hot_pages 中，直接分配而不经过分裂与
+ *  合并；更大的块分配失败时再将其归还伙伴系统。
+ */
+#define BUDDY_ORDER_NR 11 // 最大块为 2^10 页，即 4M
+#define HOT_PAGE_NR 32    // 缓存的空闲单页数量
+
+typedef struct page_t {
+    list_node_t node; // 空闲链表结点
+    u8 order;         // 空闲块的阶
+    bool free;        // 空闲块的首页
+} page_t;
+
+static page_t *page_table;   // 伙伴系统管理的页，第 0 项对应 buddy_base
+static u32 page_table_pages; // page_table 占用的页数
+static u32 buddy_base;       // 伙伴系统管理的第一页
+static u32 buddy_pages;      // 伙伴系统管理的页数
+
+static list_t free_area[BUDDY_ORDER_NR]; // 各阶的空闲块链表
+static u32 free_blocks[BUDDY_ORDER_NR];  // 各阶的空闲块数量
+
+static u32 hot_pages[HOT_PAGE_NR]; // 最近释放的单页
+static u32 hot_count;
+
+// 将相对于 buddy_base 第 idx 页开始的 order 阶块加入空闲链表
+static void buddy_insert(u32 idx, u32 order) {
+    page_t *page = &page_table[idx];
+    page->order = order;
+    page->free = true;
+    // list_push 会遍历链表检查结点，空闲链表可能很长
+    list_insert_after(&free_area[order].head, &page->node);
+    free_blocks[order]++;
+}
+
+static void buddy_remove(u32 idx) {
+    page_t *page = &page_table[idx];
+    assert(page->free);
+    page->free = false;
+    list_remove(&page->node);
+    free_blocks[page->order]--;
+}
+
+// 伙伴系统管理 buddy_base 之后的所有可用区域，区域之间的空洞不会被合并
+static void buddy_init() {
+    buddy_pages = total_pages - buddy_base;
+
+    for (size_t i = 0; i < BUDDY_ORDER_NR; i++) {
+        list_init(&free_area[i]);
+        free_blocks[i] = 0;
+    }
+    memset(page_table, 0, buddy_pages * sizeof(page_t));
+
+    for (size_t i = 0; i < zone_count; i++) {
+        if (zones[i].end <= buddy_base) {
+            continue;
+        }
+        u32 idx = MAX(zones[i].start, buddy_base) - buddy_base;
+        u32 end = zones[i].end - buddy_base;
+
+        // 按对齐要求加入尽可能大的块
+        while (idx < end) {
+            u32 order = BUDDY_ORDER_NR - 1;
+            while ((idx & ((1 << order) - 1)) || idx + (1 << order) > end) {
+                order--;
+            }
+            buddy_insert(idx, order);
+            idx += 1 << order;
+        }
+    }
+}
+
+// 释放相对于 buddy_base 第 idx 页开始的 order 阶块，与空闲的伙伴合并
+static void buddy_free(u32 idx, u32 order) {
+    while (order < BUDDY_ORDER_NR - 1) {
+        u32 buddy = idx ^ (1 << order);
+        if (buddy >= buddy_pages) {
+            break;
+        }
+        page_t *page = &page_table[buddy];
+        if (!page->free || page->order != order) {
+            break;
+        }
+        buddy_remove(buddy);
+        idx &= ~(1 << order);
+        order++;
+    }
+    buddy_insert(idx, order);
+}
+
+// 热页归还伙伴系统
+static void hot_drain() {
+    while (hot_count) {
+        buddy_free(hot_pages[--hot_count] - buddy_base, 0);
+    }
+}
+
+/*
+ *  预先清零的页
+ *
+ *  分配后清零在缺页和 fork 的关键路径上。空闲进程在后台把空闲页清零后放入
+ *  池中，需要清零的分配优先从池中获取。池中的页已被分配，内存不足时再归还。
+ *  物理页通过 kmap 清零，内核页直接清零。
+ */
+#define ZERO_POOL_SIZE 32
+
+static u32 zero_pages[ZERO_POOL_SIZE];  // 清零的物理页
+static u32 zero_count;
+static u32 zero_kpages[ZERO_POOL_SIZE]; // 清零的内核页
+static u32 zero_kcount;
+static u32 zero_hits;   // 从池中取得清零页的次数
+static u32 zero_misses; // 池为空，分配后清零的次数
+
+static u32 zero_page_get();
+
+// 清零的物理页归还伙伴系统
+static void zero_drain() {
+    while (zero_count) {
+        u32 idx = IDX(zero_pages[--zero_count]);
+        assert(memory_map[idx] == 1);
+        memory_map[idx] = 0;
+        free_pages++;
+        buddy_free(idx - buddy_base, 0);
+    }
+}
+
+// 分配 order 阶块，返回相对于 buddy_base 的页索引，没有内存返回 EOF
+static u32 buddy_alloc(u32 order) {
+    u32 current = order;
+    while (current < BUDDY_ORDER_NR && list_empty(&free_area[current])) {
+        current++;
+    }
+    if (current == BUDDY_ORDER_NR) {
+        return EOF;
+    }
+
+    page_t *page = element_entry(page_t, node, free_area[current].head.next);
+    u32 idx = page - page_table;
+    buddy_remove(idx);
+
+    // 分裂出的后一半放回空闲链表
+    while (current > order) {
+        current--;
+        buddy_insert(idx + (1 << current), current);
+    }
+    return idx;
+}
+
+/*
+ *  @brief  分配 2^order 个物理地址连续的页
+ *  @return  第一页的物理地址，块按其大小对齐
+ */
+u32 page_alloc(u32 order) {
+    assert(order < BUDDY_ORDER_NR);
+
+    u32 idx = buddy_alloc(order);
+    if (idx == EOF && (hot_count || zero_count)) {
+        hot_drain();
+        zero_drain();
+        idx = buddy_alloc(order);
+    }
+    if (idx == EOF) {
+        panic("Out of memory");
+    }
+
+    u32 count = 1 << order;
+    idx += buddy_base;
+    for (size_t i = 0; i < count; i++) {
+        assert(!memory_map[idx + i]);
+        memory_map[idx + i] = 1;
+    }
+    free_pages -= count;
+
+    u32 page = PAGE(idx);
+    DEBUGK("Allocate %d pages 0x%p\n", count, page);
+    return page;
+}
+
+// 释放 page_alloc 分配的 2^order 个页，每页只能有一个引用
+void page_free(u32 addr, u32 order) {
+    ASSERT_PAGE(addr);
+    assert(order < BUDDY_ORDER_NR);
+
+    u32 idx = IDX(addr);
+    u32 count = 1 << order;
+    assert(idx >= buddy_base && idx + count <= total_pages);
+    assert(!((idx - buddy_base) & (count - 1)));
+
+    for (size_t i = 0; i < count; i++) {
+        assert(memory_map[idx + i] == 1);
+        memory_map[idx + i] = 0;
+    }
+    free_pages += count;
+    buddy_free(idx - buddy_base, order);
+}
+
+/*
+ *  页缓存，以 (inode, 页偏移) 为索引
+ *
+ *  文件映射的页在缺页时才从页缓存中获取，页缓存持有物理页的一个引用，
+ *  每个映射了该页的页表项各持有一个引用。MAP_SHARED 的映射直接共享该页，
+ *  MAP_PRIVATE 的映射只读共享，写入时由写时复制得到私有的页。
+ */
+#define PAGE_CACHE_HASH 31
+
+typedef struct page_cache_t {
+    struct inode_t *inode; // 文件 inode
+    idx_t index;           // 文件中的页偏移
+    u32 paddr;             // 物理页
+    bool valid;            // 内容已从文件读入
+    list_node_t node;      // 哈希表结点
+} page_cache_t;
+
+static list_t page_cache_table[PAGE_CACHE_HASH];
+static kmem_cache_t *page_cache_cache;
+static kmem_cache_t *mmap_cache;
+static wait_queue_t page_cache_wait; // 等待页读入的进程
+
 bitmap_t kernel_map;
 
+/*
+ *  内核虚拟页的空闲区间
+ *
+ *  [kpage_start, kpage_end) 中连续的空闲页组成区间，区间第一页的开头存放
+ *  kextent_t，最后一页的末尾存放区间的起始地址，释放时据此与相邻的空闲区间
+ *  合并。页数在 [2^i, 2^(i+1)) 中的区间挂在第 i 个链表中，分配时从能满足的
+ *  最小链表中取出区间，切下前面的部分。kernel_map 仍然记录每页是否被占用。
+ */
+#define KEXTENT_LIST_NR 12
+
+typedef struct kextent_t {
+    list_node_t node; // 空闲链表结点
+    u32 count;        // 页数
+    u32 magic;        // 魔数
+} kextent_t;
+
+static list_t kextent_list[KEXTENT_LIST_NR];
+static u32 kpage_start; // 内核虚拟页分配的起始地址
+static u32 kpage_end;   // 内核虚拟页分配的结束地址，之后是高速缓冲
+static u32 kpage_free;  // 空闲的内核虚拟页数
+
+// 区间最后一页末尾的起始地址
+#define KEXTENT_TAIL(addr, count) ((u32 *)((addr) + (count) * PAGE_SIZE) - 1)
+
+static u32 kextent_class(u32 count) {
+    u32 class = 0;
+    while (count >>= 1) {
+        class++;
+    }
+    return MIN(class, KEXTENT_LIST_NR - 1);
+}
+
+static void kextent_insert(u32 addr, u32 count) {
+    kextent_t *ext = (kextent_t *)addr;
+    ext->count = count;
+    ext->magic = OAK_MAGIC;
+    *KEXTENT_TAIL(addr, count) = addr;
+    list_insert_after(&kextent_list[kextent_class(count)].head, &ext->node);
+}
+
+static void kextent_remove(kextent_t *ext) {
+    assert(ext->magic == OAK_MAGIC);
+    ext->magic = 0;
+    list_remove(&ext->node);
+}
+
+static void kextent_init() {
+    // 范围之外的页不参与分配
+    u32 end = kernel_map.offset + kernel_map.length * 8;
+    for (u32 idx = kernel_map.offset; idx < end; idx++) {
+        if (idx < IDX(kpage_start) || idx >= IDX(kpage_end)) {
+            bitmap_set(&kernel_map, idx, true);
+        }
+    }
+
+    for (size_t i = 0; i < KEXTENT_LIST_NR; i++) {
+        list_init(&kextent_list[i]);
+    }
+    kpage_free = IDX(kpage_end - kpage_start);
+    kextent_insert(kpage_start, kpage_free);
+}
+
+/*
+ *  @brief  按内存大小划分内核内存
+ *
+ *  内核的 16M 依次为 memory_map 和伙伴系统的页数组、内核页、高速缓冲和内存盘，
+ *  剩余部分交给伙伴系统。高速缓冲和内存盘各为内存的 1/8，按 1M 对齐；
+ *  内存较小时留给用户的页更多，较大时高速缓冲可以用满内核内存
+ */
+static void kernel_layout() {
+    u32 share = PAGE(total_pages / 8) & ~(MEMORY_BASE - 1);
+
+    kpage_start = PAGE(start_page);
+    kpage_end = kpage_start + KERNEL_KPAGE_SIZE;
+    if (kpage_end + KERNEL_BUFFER_MIN + KERNEL_RAMDISK_MIN >
+        KERNEL_MEMORY_SIZE) {
+        panic("Kernel memory is too small for memory map\n");
+    }
+    u32 room = KERNEL_MEMORY_SIZE - kpage_end;
+
+    kernel_ramdisk_size = MIN(MAX(share, KERNEL_RAMDISK_MIN), KERNEL_RAMDISK_MAX);
+    kernel_buffer_size = MIN(MAX(share, KERNEL_BUFFER_MIN),
+                             room - kernel_ramdisk_size);
+
+    kernel_buffer_mem = kpage_end;
+    kernel_ramdisk_mem = kernel_buffer_mem + kernel_buffer_size;
+    buddy_base = IDX(kernel_ramdisk_mem + kernel_ramdisk_size);
+
+    DEBUGK("Buffer 0x%p size 0x%p, ramdisk 0x%p size 0x%p\n",
+           kernel_buffer_mem, kernel_buffer_size, kernel_ramdisk_mem,
+           kernel_ramdisk_size);
+}
+
 /*
  *  @brief  内核内存管理初始化
  *
@@ -131,15 +522,25 @@ void memory_map_init() {
 
     // place the array in memory_base(0x100000)
     memory_map = (u8 *)memory_base;
-    // size of the array
-    memset((void *)memory_map, 0, memory_map_pages * PAGE_SIZE);
+    // 内核内存和区域之间的空洞都视为已占用
+    memset((void *)memory_map, 1, memory_map_pages * PAGE_SIZE);
 
     free_pages -= memory_map_pages;
 
-    start_page = IDX(memory_base) + memory_map_pages;
+    // 伙伴系统的页数组紧随 memory_map 之后，伙伴系统可能从 16M 以下开始
+    page_table = (page_t *)(memory_base + memory_map_pages * PAGE_SIZE);
+    page_table_pages = div_round_up(
+        (total_pages - IDX(MEMORY_BASE)) * sizeof(page_t), PAGE_SIZE);
+    free_pages -= page_table_pages;
+
+    start_page = IDX(memory_base) + memory_map_pages + page_table_pages;
+    kernel_layout();
 
-    for (size_t i = 0; i < start_page; i++) {
-        memory_map[i] = 1;
+    for (size_t i = 0; i < zone_count; i++) {
+        for (u32 idx = MAX(zones[i].start, buddy_base); idx < zones[i].end;
+             idx++) {
+            memory_map[idx] = 0;
+        }
     }
 
     // DEBUGK("Total pages %d, free pages %d\n", total_pages, free_pages);
@@ -147,8 +548,21 @@ void memory_map_init() {
     // manage kernel virtual memory with bitmap
     u32 length = IDX(KERNEL_MEMORY_SIZE) / 8;
     bitmap_init(&kernel_map, (u8 *)KERNEL_MAP_BITS, length, IDX(MEMORY_BASE));
-    // pages for memory_map
-    bitmap_scan(&kernel_map, memory_map_pages);
+    kextent_init();
+
+    buddy_init();
+
+    for (size_t i = 0; i < PAGE_CACHE_HASH; i++) {
+        list_init(&page_cache_table[i]);
+    }
+    wait_init(&page_cache_wait);
+    page_cache_cache = kmem_cache_create("page_cache_t", sizeof(page_cache_t),
+                                         NULL);
+    mmap_cache = kmem_cache_create("mmap_t", sizeof(mmap_t), NULL);
+
+    // 此时还未开启分页，内核页的虚拟地址就是物理地址
+    zero_page = alloc_kpage(1);
+    memset((void *)zero_page, 0, PAGE_SIZE);
 }
 
 /* Allocate one physical page
@@ -156,17 +570,17 @@ void memory_map_init() {
  * @return The page address
  */
 static u32 alloc_page() {
-    for (size_t i = start_page; i < total_pages; i++) {
-        if (!memory_map[i]) {
-            memory_map[i] = 1;
-            free_pages--;
-            u32 page = PAGE(i);
-            DEBUGK("Allocate page 0x%p\n", page);
-            return page;
-        }
+    if (!hot_count) {
+        return page_alloc(0);
     }
-    panic("Out of memory");
-    return 0; // not necessary
+
+    u32 idx = hot_pages[--hot_count];
+    assert(!memory_map[idx]);
+    memory_map[idx] = 1;
+    free_pages--;
+    u32 page = PAGE(idx);
+    DEBUGK("Allocate page 0x%p\n", page);
+    return page;
 }
 
 /* Free one physical page
@@ -187,7 +601,14 @@ static void free_page(u32 addr) {
     memory_map[idx]--;
 
     if (!memory_map[idx]) {
+        // 伙伴系统之外的内核内存总有一个引用
+        assert(idx >= buddy_base);
         free_pages++;
+        if (hot_count < HOT_PAGE_NR) {
+            hot_pages[hot_count++] = idx;
+        } else {
+            buddy_free(idx - buddy_base, 0);
+        }
     }
 
     assert(free_pages > 0 && free_pages < total_pages);
@@ -219,16 +640,28 @@ void set_cr3(u32 pde) {
 
 /* Enable paging
  *
- * Set the highest bit of cr0 to 1 to enable paging
+ * Set the highest bit of cr0 to 1 to enable paging, and set WP so that the
+ * kernel also faults on writing read-only user pages, which is required by
+ * copy on write and the shared zero page
  */
 static _inline void enable_page() {
-    // 0b1000_0000_0000_0000_0000_0000_0000_0000
-    // 0x80000000
+    // 0b1000_0000_0000_0001_0000_0000_0000_0000
+    // 0x80010000
     asm volatile("movl %cr0, %eax\n"
-                 "orl $0x80000000, %eax\n"
+                 "orl $0x80010000, %eax\n"
                  "movl %eax, %cr0\n");
 }
 
+#define CR4_PSE (1 << 4) // 4M page
+#define CR4_PGE (1 << 7) // global page
+
+static _inline void set_cr4_bits(u32 bits) {
+    asm volatile("movl %%cr4, %%eax\n"
+                 "orl %%ebx, %%eax\n"
+                 "movl %%eax, %%cr4\n" ::"b"(bits)
+                 : "eax");
+}
+
 /* Initialize page table entry of page directory entry
  *
  * @param entry Address of entry
@@ -251,39 +684,43 @@ static void entry_init(page_entry_t *entry, u32 index) {
  *  系统采用二级页表。顶级页表称为页目录，一般只有一个页目录。页目录项存储页表
  *  的地址。
  *
- * Place page directory which is 4K bytes in size in 0x1000.Page directory has
- * 3 page table in index 0, 1 and 1023.The top 2 map the virtual 8M to physical
- * 8M(ignore first 4K). The last one in index 1023 points to the directory
- * itself therefore we can modify the page directory and page table through
- * this entry.
+ *  内核映射的 16M 是所有进程共享的，页表项设置全局位，切换页目录时
+ *  不会从 TLB 中清除。第一个 4M 使用页表，第 0 页不作映射，用于检测空指针
+ *  和 kmap()；其余 12M 使用 4M 大页，不需要页表，也只占用一个 TLB 项。
+ *  KERNEL_PAGE_TABLE 中只有第一个页表在使用，数组长度是内核的页目录项数。
+ *
+ * Place page directory which is 4K bytes in size in 0x1000. The last entry in
+ * index 1023 points to the directory itself therefore we can modify the page
+ * directory and page table through this entry.
  */
 void mapping_init() {
     // 初始化页目录
     page_entry_t *pde = (page_entry_t *)KERNEL_PAGE_DIR;
     memset(pde, 0, PAGE_SIZE);
 
-    idx_t index = 0;
-    for (idx_t didx = 0; didx < (sizeof(KERNEL_PAGE_TABLE) / 4); didx++) {
-        // 初始化页表
-        page_entry_t *pte = (page_entry_t *)KERNEL_PAGE_TABLE[didx];
-        memset(pte, 0, PAGE_SIZE);
+    // 初始化第一个页表
+    page_entry_t *pte = (page_entry_t *)KERNEL_PAGE_TABLE[0];
+    memset(pte, 0, PAGE_SIZE);
 
-        // 初始化页目录项
-        page_entry_t *dentry = &pde[didx];
-        entry_init(dentry, IDX((u32)pte));
-        dentry->user = 0;
+    page_entry_t *dentry = &pde[0];
+    entry_init(dentry, IDX((u32)pte));
+    dentry->user = 0;
 
-        // 初始化页表项
-        for (size_t tidx = 0; tidx < 1024; tidx++, index++) {
-            // 第 0 个页表不作映射
-            if (index == 0) {
-                continue;
-            }
-            page_entry_t *tentry = &pte[tidx];
-            entry_init(tentry, index);
-            tentry->user = 0;
-            memory_map[index] = 1;
-        }
+    // 第 0 页不作映射
+    for (size_t tidx = 1; tidx < 1024; tidx++) {
+        page_entry_t *tentry = &pte[tidx];
+        entry_init(tentry, tidx);
+        tentry->user = 0;
+        tentry->global = 1;
+    }
+
+    // 其余内核内存使用 4M 大页
+    for (idx_t didx = 1; didx < (sizeof(KERNEL_PAGE_TABLE) / 4); didx++) {
+        dentry = &pde[didx];
+        entry_init(dentry, didx << 10);
+        dentry->user = 0;
+        dentry->pat = 1;
+        dentry->global = 1;
     }
 
     // 最后一个页目录项指向页目录本身
@@ -291,8 +728,10 @@ void mapping_init() {
     entry_init(entry, IDX(KERNEL_PAGE_DIR));
 
     // enable paging
+    set_cr4_bits(CR4_PSE);
     set_cr3((u32)pde);
     enable_page();
+    set_cr4_bits(CR4_PGE);
 }
 
 /*
@@ -301,6 +740,8 @@ void mapping_init() {
  */
 static page_entry_t *get_pde() { return (page_entry_t *)(0xfffff000); }
 
+static void table_unshare(page_entry_t *dentry, page_entry_t *table);
+
 /*
  *  @breif  获取页表地址
  *  @param  vaddr  虚拟地址
@@ -321,9 +762,18 @@ static page_entry_t *get_pte(u32 vaddr, bool create) {
     BMB;
     if (!entry->present) {
         DEBUGK("Get and create page table entry for 0x%p\n", vaddr);
-        u32 page = alloc_page();
+        u32 page = zero_page_get();
+        bool zero = page != 0;
+        if (!zero) {
+            page = alloc_page();
+        }
         entry_init(entry, IDX(page));
-        memset(table, 0, PAGE_SIZE);
+        if (!zero) {
+            memset(table, 0, PAGE_SIZE);
+        }
+    } else if (!entry->write) {
+        // fork 后共享的页表，修改之前复制
+        table_unshare(entry, table);
     }
     BMB;
 
@@ -348,6 +798,46 @@ void flush_tlb(u32 vaddr) {
     asm volatile("invlpg (%0)" ::"r"(vaddr) : "memory");
 }
 
+/*
+ *  批量无效化 TLB
+ *
+ *  修改多个页表项时先记录页地址，最后一起无效化；页数超过 TLB_BATCH_NR 时
+ *  逐页 invlpg 不如重新加载 cr3，内核页是全局的，不受影响
+ */
+void tlb_batch_init(tlb_batch_t *batch) { batch->count = 0; }
+
+void tlb_batch_add(tlb_batch_t *batch, u32 vaddr) {
+    if (batch->count < TLB_BATCH_NR) {
+        batch->pages[batch->count] = vaddr;
+    }
+    if (batch->count <= TLB_BATCH_NR) {
+        batch->count++;
+    }
+}
+
+void tlb_batch_range(tlb_batch_t *batch, u32 start, u32 end) {
+    if (IDX(end - start) > TLB_BATCH_NR) {
+        batch->count = TLB_BATCH_NR + 1;
+        return;
+    }
+    for (u32 vaddr = start; vaddr < end; vaddr += PAGE_SIZE) {
+        tlb_batch_add(batch, vaddr);
+    }
+}
+
+void tlb_batch_flush(tlb_batch_t *batch) {
+    if (batch->count > TLB_BATCH_NR) {
+        set_cr3(get_cr3());
+        tlb_flushes++;
+    } else {
+        for (size_t i = 0; i < batch->count; i++) {
+            flush_tlb(batch->pages[i]);
+        }
+        tlb_pages += batch->count;
+    }
+    batch->count = 0;
+}
+
 /*
  *  @brief  分配连续虚拟页
  *  @param  map  位图
@@ -367,34 +857,57 @@ static u32 scan_page(bitmap_t *map, u32 count) {
     return addr;
 }
 
-/*
- *  @breif  释放分配的虚拟页
- *  @param  map  位图
- *  @param  addr  需要释放的页的地址
- *  @param  count  需要释放的页数
- */
-static void reset_page(bitmap_t *map, u32 addr, u32 count) {
-    ASSERT_PAGE(addr);
-    assert(count > 0);
-
-    u32 index = IDX(addr);
-
-    for (size_t i = 0; i < count; i++) {
-        assert(bitmap_is_set(map, index + i));
-        bitmap_set(map, index + i, false);
-    }
-}
-
 /*
  *  @brief  分配连续虚拟页
  *  @param  count  需要分配的页数
  *  @return  分配到的第一个页的地址
  *
- *  对 scan_page 的包装
+ *  在第一个能满足的链表中首次适配，更大的链表中任意区间都能满足
  */
+static kextent_t *kextent_find(u32 count) {
+    for (u32 i = kextent_class(count); i < KEXTENT_LIST_NR; i++) {
+        list_t *list = &kextent_list[i];
+        for (list_node_t *node = list->head.next; node != &list->tail;
+             node = node->next) {
+            kextent_t *ext = element_entry(kextent_t, node, node);
+            if (ext->count >= count) {
+                return ext;
+            }
+        }
+    }
+    return NULL;
+}
+
 u32 alloc_kpage(u32 count) {
     assert(count > 0);
-    u32 vaddr = scan_page(&kernel_map, count);
+
+    kextent_t *ext = kextent_find(count);
+
+    // 归还清零的内核页后再试
+    if (!ext && zero_kcount) {
+        while (zero_kcount) {
+            free_kpage(zero_kpages[--zero_kcount], 1);
+        }
+        ext = kextent_find(count);
+    }
+
+    if (!ext) {
+        panic("Not enough pages!\n");
+    }
+
+    u32 vaddr = (u32)ext;
+    u32 left = ext->count - count;
+    kextent_remove(ext);
+    if (left) {
+        kextent_insert(vaddr + count * PAGE_SIZE, left);
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        assert(!bitmap_is_set(&kernel_map, IDX(vaddr) + i));
+        bitmap_set(&kernel_map, IDX(vaddr) + i, true);
+    }
+    kpage_free -= count;
+
     DEBUGK("allocate kernel page 0x%p count %d\n", vaddr, count);
     return vaddr;
 }
@@ -404,13 +917,35 @@ u32 alloc_kpage(u32 count) {
  *  @param  addr  需要释放的页的地址
  *  @param  count  需要释放的页数
  *
- *  对 reset_page 的包装
+ *  与前后相邻的空闲区间合并
  */
 void free_kpage(u32 vaddr, u32 count) {
     ASSERT_PAGE(vaddr);
     assert(count > 0);
-    reset_page(&kernel_map, vaddr, count);
+    assert(vaddr >= kpage_start && vaddr + count * PAGE_SIZE <= kpage_end);
+
+    for (size_t i = 0; i < count; i++) {
+        assert(bitmap_is_set(&kernel_map, IDX(vaddr) + i));
+        bitmap_set(&kernel_map, IDX(vaddr) + i, false);
+    }
+    kpage_free += count;
     DEBUGK("free kernel page 0x%p count %d\n", vaddr, count);
+
+    if (vaddr > kpage_start && !bitmap_is_set(&kernel_map, IDX(vaddr) - 1)) {
+        kextent_t *prev = (kextent_t *)*(u32 *)(vaddr - sizeof(u32));
+        kextent_remove(prev);
+        vaddr = (u32)prev;
+        count += prev->count;
+    }
+
+    u32 end = vaddr + count * PAGE_SIZE;
+    if (end < kpage_end && !bitmap_is_set(&kernel_map, IDX(end))) {
+        kextent_t *next = (kextent_t *)end;
+        kextent_remove(next);
+        count += next->count;
+    }
+
+    kextent_insert(vaddr, count);
 }
 
 /**
@@ -431,18 +966,23 @@ void link_page(u32 vaddr) {
         return;
     }
 
-    u32 paddr = alloc_page();
+    // 匿名页的旧内容不能泄露给进程
+    u32 paddr = zero_page_get();
+    bool zero = paddr != 0;
+    if (!zero) {
+        paddr = alloc_page();
+    }
     entry_init(entry, IDX(paddr));
     flush_tlb(vaddr);
+    if (!zero) {
+        memset((void *)vaddr, 0, PAGE_SIZE);
+    }
 
     DEBUGK("link from 0x%p to 0x%p\n", vaddr, paddr);
 }
 
-/**
- *  @brief  解绑虚拟页与物理页
- *  @param  vaddr  虚拟地址
- */
-void unlink_page(u32 vaddr) {
+// 解绑虚拟页与物理页，TLB 由调用者批量无效化
+static void page_unlink(u32 vaddr, tlb_batch_t *batch) {
     ASSERT_PAGE(vaddr);
 
     page_entry_t *pde = get_pde();
@@ -464,70 +1004,237 @@ void unlink_page(u32 vaddr) {
 
     DEBUGK("unlink page from 0x%p to 0x%p\n", vaddr, paddr);
 
-    free_page(paddr);
-    flush_tlb(vaddr);
+    if (paddr != zero_page) {
+        free_page(paddr);
+    }
+    tlb_batch_add(batch, vaddr);
 }
 
-static u32 copy_page(void *page) {
-    // 分配一页物理页
-    u32 paddr = alloc_page();
+/**
+ *  @brief  解绑虚拟页与物理页
+ *  @param  vaddr  虚拟地址
+ */
+void unlink_page(u32 vaddr) {
+    tlb_batch_t batch;
+    tlb_batch_init(&batch);
+    page_unlink(vaddr, &batch);
+    tlb_batch_flush(&batch);
+}
+
+/*
+ *  @brief  将物理页临时映射到第 0 页
+ *  @param  paddr  物理地址
+ *  @return  可以访问该物理页的虚拟地址
+ *
+ *  内核只映射了前 16M 内存，其余的物理页需要通过第 0 页访问；
+ *  映射期间不能阻塞
+ */
+static void *kmap(u32 paddr) {
     u32 vaddr = 0;
-    // 利用第 0 页进行复制
     page_entry_t *entry = get_pte(vaddr, false);
-    // 将分配的物理页绑定到页表项
     entry_init(entry, IDX(paddr));
     flush_tlb(vaddr);
-    // 拷贝旧的页到新的物理页，通过虚拟地址找到分配的物理页
-    memcpy((void *)vaddr, (void *)page, PAGE_SIZE);
+    return (void *)vaddr;
+}
 
+// 取消第 0 页的临时映射
+static void kunmap() {
+    u32 vaddr = 0;
+    page_entry_t *entry = get_pte(vaddr, false);
     entry->present = false;
     flush_tlb(vaddr);
-    return paddr;
 }
 
-page_entry_t *copy_pde() {
-    task_t *task = running_task();
-    page_entry_t *pde = (page_entry_t *)alloc_kpage(1);
-    memcpy(pde, (void *)task->pde, PAGE_SIZE);
+// 可以立即分配的物理页数
+static u32 page_free_count() {
+    u32 count = hot_count;
+    for (size_t i = 0; i < BUDDY_ORDER_NR; i++) {
+        count += free_blocks[i] << i;
+    }
+    return count;
+}
 
-    page_entry_t *entry = &pde[1023];
-    entry_init(entry, IDX(pde));
+// 从池中取一个清零的物理页，池为空返回 0，由调用者映射后清零
+static u32 zero_page_get() {
+    if (!zero_count) {
+        zero_misses++;
+        return 0;
+    }
+    zero_hits++;
+    return zero_pages[--zero_count];
+}
 
-    page_entry_t *dentry;
+// 分配一个清零的内核页
+u32 alloc_zero_kpage() {
+    if (zero_kcount) {
+        zero_hits++;
+        return zero_kpages[--zero_kcount];
+    }
+    zero_misses++;
+    u32 page = alloc_kpage(1);
+    memset((void *)page, 0, PAGE_SIZE);
+    return page;
+}
 
-    for (size_t didx = (sizeof((KERNEL_PAGE_TABLE)) / 4); didx < 1023; didx++) {
-        dentry = &pde[didx];
-        if (!dentry->present) {
-            continue;
-        }
+/*
+ *  @brief  补充清零页池，由空闲进程调用
+ *
+ *  只在空闲内存充足时补充。物理页通过第 0 页清零，期间关闭中断；
+ *  内核页清零时可以被抢占，池只在此处增长，放入时不会溢出。
+ */
+void zero_refill() {
+    while (zero_kcount < ZERO_POOL_SIZE && kpage_free > ZERO_POOL_SIZE * 2) {
+        bool intr = interrupt_diable();
+        u32 page = alloc_kpage(1);
+        set_interrupt_state(intr);
 
-        page_entry_t *pte = (page_entry_t *)(PDE_MASK | (didx << 12));
+        memset((void *)page, 0, PAGE_SIZE);
 
-        for (size_t tidx = 0; tidx < 1024; tidx++) {
-            entry = &pte[tidx];
-            if (!entry->present) {
-                continue;
-            }
+        intr = interrupt_diable();
+        zero_kpages[zero_kcount++] = page;
+        set_interrupt_state(intr);
+    }
 
-            assert(memory_map[entry->index] > 0);
+    while (zero_count < ZERO_POOL_SIZE) {
+        bool intr = interrupt_diable();
 
-            if (!entry->shared) {
-                entry->write = false;
+        if (page_free_count() <= ZERO_POOL_SIZE * 2) {
+            set_interrupt_state(intr);
+            break;
+        }
+
+        u32 paddr = alloc_page();
+        void *vaddr = kmap(paddr);
+        memset(vaddr, 0, PAGE_SIZE);
+        kunmap();
+        zero_pages[zero_count++] = paddr;
+
+        set_interrupt_state(intr);
+    }
+}
+
+static u32 copy_page(void *page) {
+    // 分配一页物理页
+    u32 paddr = alloc_page();
+    // 利用第 0 页进行复制，通过虚拟地址找到分配的物理页
+    void *vaddr = kmap(paddr);
+    // 拷贝旧的页到新的物理页
+    memcpy(vaddr, (void *)page, PAGE_SIZE);
+    kunmap();
+    return paddr;
+}
+
+/*
+ *  @brief  复制共享的页表
+ *  @param  dentry  页目录项
+ *  @param  table  页表的虚拟地址
+ *
+ *  fork 时父子进程共享页表，双方的页目录项都是只读的。第一次修改页表或者
+ *  写入其中的页时，若页表仍被共享则复制一份，其中的页改为写时复制；
+ *  若其他进程已经不再使用，直接恢复页目录项的写权限。
+ */
+static void table_unshare(page_entry_t *dentry, page_entry_t *table) {
+    assert(memory_map[dentry->index] > 0);
+
+    if (memory_map[dentry->index] > 1) {
+        // 页表的递归映射是只读的，通过第 0 页修改；
+        // 共享页表的其他进程也需要写时复制，直接修改原页表
+        page_entry_t *pte = kmap(PAGE(dentry->index));
+        for (size_t tidx = 0; tidx < 1024; tidx++) {
+            page_entry_t *entry = &pte[tidx];
+            if (!entry->present || entry->index == IDX(zero_page)) {
+                continue;
+            }
+
+            assert(memory_map[entry->index] > 0);
+
+            if (!entry->shared) {
+                entry->write = false;
             }
 
             memory_map[entry->index]++;
 
             assert(memory_map[entry->index] < 255);
         }
+        kunmap();
 
-        u32 paddr = copy_page(pte);
+        u32 paddr = copy_page(table);
+        memory_map[dentry->index]--;
         dentry->index = IDX(paddr);
+        table_copies++;
+    }
+
+    dentry->write = true;
+    set_cr3(get_cr3());
+}
+
+// 释放页表及其中的页，页表仍被其他进程共享时只释放引用
+static void table_free(page_entry_t *dentry, page_entry_t *table) {
+    if (memory_map[dentry->index] == 1) {
+        for (size_t tidx = 0; tidx < 1024; tidx++) {
+            page_entry_t *entry = &table[tidx];
+            if (!entry->present) {
+                continue;
+            }
+
+            if (entry->index == IDX(zero_page)) {
+                continue;
+            }
+
+            assert(memory_map[entry->index] > 0);
+            free_page(PAGE(entry->index));
+        }
+    }
+
+    free_page(PAGE(dentry->index));
+}
+
+/*
+ *  @brief  复制当前进程的页目录
+ *
+ *  只复制页目录，页表由父子进程共享，双方的页目录项置为只读，
+ *  写入时再复制页表，见 table_unshare()
+ */
+page_entry_t *copy_pde() {
+    task_t *task = running_task();
+    page_entry_t *pde = (page_entry_t *)alloc_kpage(1);
+    memcpy(pde, (void *)task->pde, PAGE_SIZE);
+
+    page_entry_t *entry = &pde[1023];
+    entry_init(entry, IDX(pde));
+
+    page_entry_t *parent = get_pde();
+
+    for (size_t didx = (sizeof((KERNEL_PAGE_TABLE)) / 4); didx < 1023; didx++) {
+        page_entry_t *dentry = &pde[didx];
+        if (!dentry->present) {
+            continue;
+        }
+
+        dentry->write = false;
+        parent[didx].write = false;
+
+        memory_map[dentry->index]++;
+
+        assert(memory_map[dentry->index] < 255);
     }
     set_cr3(task->pde);
 
     return pde;
 }
 
+// 创建只有内核映射的页目录
+page_entry_t *create_pde() {
+    page_entry_t *pde = (page_entry_t *)alloc_kpage(1);
+    memset(pde, 0, PAGE_SIZE);
+    memcpy(pde, get_pde(),
+           (sizeof(KERNEL_PAGE_TABLE) / 4) * sizeof(page_entry_t));
+
+    page_entry_t *entry = &pde[1023];
+    entry_init(entry, IDX(pde));
+    return pde;
+}
+
 void free_pde() {
     task_t *task = running_task();
     assert(task->uid != KERNEL_USER);
@@ -541,20 +1248,40 @@ void free_pde() {
         }
 
         page_entry_t *pte = (page_entry_t *)(PDE_MASK | (didx << 12));
+        table_free(dentry, pte);
+        DEBUGK("free pages %d\n", free_pages);
+    }
+}
 
-        for (size_t tidx = 0; tidx < 1024; tidx++) {
-            page_entry_t *entry = &pte[tidx];
-            if (!entry->present) {
-                continue;
-            }
+/*
+ *  @brief  解除 [start, end) 的映射
+ *
+ *  完整覆盖的页表整体释放，不必逐页解除，共享的页表也不会被复制
+ */
+static void unlink_range(u32 start, u32 end) {
+    page_entry_t *pde = get_pde();
+    tlb_batch_t batch;
+    tlb_batch_init(&batch);
 
-            assert(memory_map[entry->index] > 0);
-            free_page(PAGE(entry->index));
-        }
+    for (u32 vaddr = start; vaddr < end;) {
+        u32 didx = DIDX(vaddr);
+        u32 next = (vaddr & ~(TABLE_SIZE - 1)) + TABLE_SIZE;
+        page_entry_t *dentry = &pde[didx];
 
-        free_page(PAGE(dentry->index));
-        DEBUGK("free pages %d\n", free_pages);
+        if (dentry->present && vaddr == next - TABLE_SIZE && next <= end) {
+            page_entry_t *pte = (page_entry_t *)(PDE_MASK | (didx << 12));
+            table_free(dentry, pte);
+            dentry->present = false;
+            tlb_batch_range(&batch, vaddr, next);
+        } else if (dentry->present) {
+            for (u32 page = vaddr; page < MIN(next, end); page += PAGE_SIZE) {
+                page_unlink(page, &batch);
+            }
+        }
+        vaddr = next;
     }
+
+    tlb_batch_flush(&batch);
 }
 
 int sys_brk(void *addr) {
@@ -570,9 +1297,8 @@ int sys_brk(void *addr) {
     u32 old_brk = task->brk;
 
     if (old_brk > brk) {
-        for (u32 page = brk; page < old_brk; page += PAGE_SIZE) {
-            unlink_page(page);
-        }
+        // brk 之上没有映射，释放到页表边界，使 execve 可以整体释放共享的页表
+        unlink_range(brk, (old_brk + TABLE_SIZE - 1) & ~(TABLE_SIZE - 1));
     } else if (IDX((brk - old_brk)) > free_pages) {
         return -1;
     }
@@ -580,6 +1306,228 @@ int sys_brk(void *addr) {
     return 0;
 }
 
+static list_t *page_cache_list(inode_t *inode, idx_t index) {
+    return &page_cache_table[((u32)inode ^ index) % PAGE_CACHE_HASH];
+}
+
+static page_cache_t *page_cache_find(inode_t *inode, idx_t index) {
+    list_t *list = page_cache_list(inode, index);
+    for (list_node_t *node = list->head.next; node != &list->tail;
+         node = node->next) {
+        page_cache_t *page = element_entry(page_cache_t, node, node);
+        if (page->inode == inode && page->index == index) {
+            return page;
+        }
+    }
+    return NULL;
+}
+
+/*
+ *  @brief  将 inode 第 index 页映射到虚拟地址 vaddr
+ *  @return  映射的页表项
+ *
+ *  页不在缓存中时，分配物理页并通过 vaddr 从文件读入
+ */
+static page_entry_t *page_cache_map(inode_t *inode, idx_t index, u32 vaddr) {
+    page_entry_t *entry = get_entry(vaddr, true);
+    assert(!entry->present);
+
+    page_cache_t *page = page_cache_find(inode, index);
+    if (page) {
+        // 其他进程正在读入该页
+        while (!page->valid) {
+            wait_sleep(&page_cache_wait);
+        }
+        memory_map[IDX(page->paddr)]++;
+        assert(memory_map[IDX(page->paddr)] < 255);
+        entry_init(entry, IDX(page->paddr));
+        flush_tlb(vaddr);
+        return entry;
+    }
+
+    page = kmem_cache_alloc(page_cache_cache);
+    page->inode = inode;
+    page->index = index;
+    page->paddr = zero_page_get();
+    page->valid = false;
+    bool zero = page->paddr != 0;
+    if (!zero) {
+        page->paddr = alloc_page();
+    }
+    list_push(page_cache_list(inode, index), &page->node);
+
+    // 页缓存与页表项各持有一个引用
+    memory_map[IDX(page->paddr)]++;
+    entry_init(entry, IDX(page->paddr));
+    flush_tlb(vaddr);
+
+    if (!zero) {
+        memset((void *)vaddr, 0, PAGE_SIZE);
+    }
+    inode_read(inode, (char *)vaddr, PAGE_SIZE, index * PAGE_SIZE);
+    page->valid = true;
+    wait_wakeup(&page_cache_wait);
+    return entry;
+}
+
+void page_cache_drop(inode_t *inode) {
+    for (size_t i = 0; i < PAGE_CACHE_HASH; i++) {
+        list_t *list = &page_cache_table[i];
+        for (list_node_t *node = list->head.next; node != &list->tail;) {
+            page_cache_t *page = element_entry(page_cache_t, node, node);
+            node = node->next;
+            if (page->inode != inode) {
+                continue;
+            }
+            list_remove(&page->node);
+            free_page(page->paddr);
+            kmem_cache_free(page_cache_cache, page);
+        }
+    }
+}
+
+// 文件被截断后，缓存的页可能仍被共享映射，清零而不是释放，
+// 映射与文件保持一致，解除映射时写回的也是文件当前的内容
+void page_cache_zero(inode_t *inode) {
+    for (size_t i = 0; i < PAGE_CACHE_HASH; i++) {
+        list_t *list = &page_cache_table[i];
+        for (list_node_t *node = list->head.next; node != &list->tail;
+             node = node->next) {
+            page_cache_t *page = element_entry(page_cache_t, node, node);
+            if (page->inode != inode || !page->valid) {
+                continue;
+            }
+            void *vaddr = kmap(page->paddr);
+            memset(vaddr, 0, PAGE_SIZE);
+            kunmap();
+        }
+    }
+}
+
+void page_cache_insert(inode_t *inode, idx_t index, u32 paddr) {
+    assert(!page_cache_find(inode, index));
+    page_cache_t *page = kmem_cache_alloc(page_cache_cache);
+    page->inode = inode;
+    page->index = index;
+    page->paddr = paddr;
+    page->valid = true;
+    list_push(page_cache_list(inode, index), &page->node);
+
+    // 内核页的引用计数至少为 1，页缓存释放时不会被当作空闲页
+    memory_map[IDX(paddr)]++;
+}
+
+void page_cache_write(inode_t *inode, char *buf, u32 len, off_t offset) {
+    u32 end = offset + len;
+    for (u32 pos = offset; pos < end;) {
+        idx_t index = pos / PAGE_SIZE;
+        u32 start = pos % PAGE_SIZE;
+        u32 chars = MIN(PAGE_SIZE - start, end - pos);
+
+        page_cache_t *page = page_cache_find(inode, index);
+        if (page && page->valid) {
+            void *vaddr = kmap(page->paddr);
+            memcpy(vaddr + start, buf, chars);
+            kunmap();
+        }
+        pos += chars;
+        buf += chars;
+    }
+}
+
+static mmap_t *mmap_find(task_t *task, u32 vaddr) {
+    list_t *list = &task->mmaps;
+    for (list_node_t *node = list->head.next; node != &list->tail;
+         node = node->next) {
+        mmap_t *area = element_entry(mmap_t, node, node);
+        if (area->start <= vaddr && vaddr < area->end) {
+            return area;
+        }
+    }
+    return NULL;
+}
+
+// 设置映射页的页表项属性
+static void mmap_entry(mmap_t *area, page_entry_t *entry) {
+    entry->user = true;
+    entry->write = false;
+    entry->readonly = true;
+    if (area->prot & PROT_WRITE) {
+        entry->readonly = false;
+        entry->write = true;
+    }
+    if (area->flags & MAP_SHARED) {
+        entry->shared = true;
+    }
+    if (area->flags & MAP_PRIVATE) {
+        entry->private = true;
+        // 私有的文件页与页缓存共享，写入时复制
+        if (area->inode) {
+            entry->write = false;
+        }
+    }
+}
+
+// 文件映射缺页，从页缓存中获取
+static void mmap_fault(mmap_t *area, u32 vaddr) {
+    idx_t index = IDX(vaddr - area->start + area->offset);
+    page_entry_t *entry = page_cache_map(area->inode, index, vaddr);
+    mmap_entry(area, entry);
+    flush_tlb(vaddr);
+}
+
+// 解除一页映射，共享文件页被写过则写回文件
+static void mmap_unlink(mmap_t *area, u32 vaddr, tlb_batch_t *batch) {
+    page_entry_t *pde = get_pde();
+    if (!pde[DIDX(vaddr)].present) {
+        return;
+    }
+
+    page_entry_t *entry = get_entry(vaddr, false);
+    if (!entry->present) {
+        return;
+    }
+
+    inode_t *inode = area->inode;
+    if (inode && !inode->uring && (area->flags & MAP_SHARED) &&
+        entry->dirty) {
+        u32 offset = vaddr - area->start + area->offset;
+        if (offset < inode->desc->size) {
+            u32 len = MIN(PAGE_SIZE, inode->desc->size - offset);
+            inode_write(inode, (char *)vaddr, len, offset);
+        }
+    }
+    page_unlink(vaddr, batch);
+}
+
+// 为 task 创建从 vaddr 开始 count 页的映射区域
+static mmap_t *mmap_create(task_t *task, u32 vaddr, u32 count, int prot,
+                           int flags, inode_t *inode, off_t offset) {
+    mmap_t *area = kmem_cache_alloc(mmap_cache);
+    area->start = vaddr;
+    area->end = vaddr + count * PAGE_SIZE;
+    area->prot = prot;
+    area->flags = flags;
+    area->inode = inode;
+    area->offset = offset;
+    list_push(&task->mmaps, &area->node);
+
+    if (inode) {
+        inode->count++;
+    }
+    return area;
+}
+
+void mmap_file(u32 vaddr, size_t length, int prot, inode_t *inode,
+               off_t offset) {
+    ASSERT_PAGE(vaddr);
+    assert((offset & 0xfff) == 0);
+
+    u32 count = div_round_up(length, PAGE_SIZE);
+    mmap_create(running_task(), vaddr, count, prot, MAP_PRIVATE, inode,
+                offset);
+}
+
 void *sys_mmap(void *addr, size_t length, int prot, int flags, int fd,
                off_t offset) {
     ASSERT_PAGE((u32)addr);
@@ -588,40 +1536,114 @@ void *sys_mmap(void *addr, size_t length, int prot, int flags, int fd,
     u32 vaddr = (u32)addr;
 
     task_t *task = running_task();
+
+    inode_t *inode = NULL;
+    if (fd != EOF) {
+        if (fd >= TASK_FILE_NR || !task->files[fd]) {
+            return (void *)EOF;
+        }
+        inode = task->files[fd]->inode;
+        // 页缓存以页为单位，偏移需要页对齐
+        if (offset & 0xfff) {
+            return (void *)EOF;
+        }
+        // uring 的队列只能共享映射，且不能超出队列的页
+        if (inode->uring) {
+            uring_t *uring = (uring_t *)inode->desc;
+            if (!(flags & MAP_SHARED) ||
+                offset + length > uring->pages * PAGE_SIZE) {
+                return (void *)EOF;
+            }
+        } else if (inode->fop != &minix_file_op ||
+                   !ISFILE(inode->desc->mode)) {
+            return (void *)EOF;
+        }
+    }
+
     if (!vaddr) {
         vaddr = scan_page(task->vmap, count);
     }
 
     assert(vaddr >= USER_MMAP_ADDR && vaddr < USER_STACK_BOTTOM);
 
+    mmap_t *area = mmap_create(task, vaddr, count, prot, flags, inode, offset);
+
     for (size_t i = 0; i < count; i++) {
         u32 page = vaddr + PAGE_SIZE * i;
-        link_page(page);
         bitmap_set(task->vmap, IDX(page), true);
 
+        // 文件映射在缺页时才建立
+        if (inode) {
+            continue;
+        }
+
+        link_page(page);
         page_entry_t *entry = get_entry(page, false);
-        entry->user = true;
-        entry->write = false;
-        entry->readonly = true;
-        if (prot & PROT_WRITE) {
-            entry->readonly = false;
-            entry->write = true;
+        mmap_entry(area, entry);
+        flush_tlb(page);
+    }
+
+    return (void *)vaddr;
+}
+
+// 从 task 的映射区域中移除 [start, end)
+static void mmap_remove(task_t *task, u32 start, u32 end) {
+    list_t *list = &task->mmaps;
+    for (list_node_t *node = list->head.next; node != &list->tail;) {
+        mmap_t *area = element_entry(mmap_t, node, node);
+        node = node->next;
+
+        if (area->end <= start || end <= area->start) {
+            continue;
+        }
+
+        // 区域中间被移除，拆分成两个区域
+        if (area->start < start && end < area->end) {
+            mmap_t *tail = kmem_cache_alloc(mmap_cache);
+            memcpy(tail, area, sizeof(mmap_t));
+            tail->start = end;
+            tail->offset = area->offset + (end - area->start);
+            tail->node.next = tail->node.prev = NULL;
+            list_push(list, &tail->node);
+            if (tail->inode) {
+                tail->inode->count++;
+            }
+            area->end = start;
+            continue;
         }
-        if (flags & MAP_SHARED) {
-            entry->shared = true;
+
+        if (area->start < start) {
+            area->end = start;
+            continue;
         }
-        if (flags & MAP_PRIVATE) {
-            entry->private = true;
+
+        if (end < area->end) {
+            area->offset += end - area->start;
+            area->start = end;
+            continue;
         }
-        flush_tlb(page);
-    }
 
-    if (fd != EOF) {
-        lseek(fd, offset, SEEK_SET);
-        read(fd, (char *)vaddr, length);
+        list_remove(&area->node);
+        iput(area->inode);
+        kmem_cache_free(mmap_cache, area);
     }
+}
 
-    return (void *)vaddr;
+// 解除 [vaddr, vaddr + count 页) 的映射
+static void mmap_release(task_t *task, u32 vaddr, u32 count) {
+    tlb_batch_t batch;
+    tlb_batch_init(&batch);
+    for (size_t i = 0; i < count; i++) {
+        u32 page = vaddr + PAGE_SIZE * i;
+        mmap_t *area = mmap_find(task, page);
+        if (area) {
+            mmap_unlink(area, page, &batch);
+        } else {
+            page_unlink(page, &batch);
+        }
+    }
+    tlb_batch_flush(&batch);
+    mmap_remove(task, vaddr, vaddr + count * PAGE_SIZE);
 }
 
 int sys_munmap(void *addr, size_t length) {
@@ -634,14 +1656,48 @@ int sys_munmap(void *addr, size_t length) {
 
     for (size_t i = 0; i < count; i++) {
         u32 page = vaddr + PAGE_SIZE * i;
-        unlink_page(page);
         assert(bitmap_is_set(task->vmap, IDX(page)));
         bitmap_set(task->vmap, IDX(page), false);
     }
 
+    mmap_release(task, vaddr, count);
     return 0;
 }
 
+void mmap_fork(task_t *child) {
+    task_t *task = running_task();
+    list_init(&child->mmaps);
+
+    list_t *list = &task->mmaps;
+    for (list_node_t *node = list->head.prev; node != &list->head;
+         node = node->prev) {
+        mmap_t *area = element_entry(mmap_t, node, node);
+        mmap_t *copy = kmem_cache_alloc(mmap_cache);
+        memcpy(copy, area, sizeof(mmap_t));
+        copy->node.next = copy->node.prev = NULL;
+        list_push(&child->mmaps, &copy->node);
+        if (copy->inode) {
+            copy->inode->count++;
+        }
+    }
+}
+
+void mmap_exit() {
+    task_t *task = running_task();
+    list_t *list = &task->mmaps;
+    while (!list_empty(list)) {
+        mmap_t *area = element_entry(mmap_t, node, list->head.next);
+        u32 count = IDX(area->end - area->start);
+        // 程序文件的映射区域不在 vmap 管理的范围内，
+        // 其中的页由 sys_brk 或 free_pde 释放，不必逐页解除
+        if (area->start >= USER_MMAP_ADDR) {
+            sys_munmap((void *)area->start, count * PAGE_SIZE);
+        } else {
+            mmap_remove(task, area->start, area->end);
+        }
+    }
+}
+
 typedef struct page_error_code_t {
     u8 present : 1;
     u8 write : 1;
@@ -655,6 +1711,149 @@ typedef struct page_error_code_t {
     u16 reserved2;
 } _packed page_error_code_t;
 
+/*
+ *  缺页预处理 (fault-around)
+ *
+ *  顺序访问一段内存时，每页都会产生一次缺页。缺页时一并处理同一窗口中的其他页：
+ *  匿名页读缺页映射零页，写缺页分配物理页；文件页只映射已在页缓存中的页；
+ *  写时复制一并复制相邻的只读页。窗口按 FAULT_AROUND_PAGES 对齐，不会跨页表。
+ */
+#define AROUND_SIZE (FAULT_AROUND_PAGES * PAGE_SIZE)
+#define AROUND_START(vaddr) ((vaddr) & ~(AROUND_SIZE - 1))
+
+// 写时复制，vaddr 为页的起始地址
+static void cow_page(page_entry_t *entry, u32 vaddr) {
+    // 写共享零页，换成私有的清零页，不需要复制
+    if (entry->index == IDX(zero_page)) {
+        u32 paddr = zero_page_get();
+        bool zero = paddr != 0;
+        if (!zero) {
+            paddr = alloc_page();
+        }
+        entry_init(entry, IDX(paddr));
+        flush_tlb(vaddr);
+        if (!zero) {
+            memset((void *)vaddr, 0, PAGE_SIZE);
+        }
+        DEBUGK("ZERO page break for 0x%p\n", vaddr);
+        return;
+    }
+
+    assert(memory_map[entry->index] > 0);
+    if (memory_map[entry->index] == 1) {
+        entry->write = true;
+        flush_tlb(vaddr);
+        DEBUGK("WRITE page for 0x%p\n", vaddr);
+    } else {
+        u32 paddr = copy_page((void *)vaddr);
+        cow_count++;
+        memory_map[entry->index]--;
+        entry_init(entry, IDX(paddr));
+        flush_tlb(vaddr);
+        DEBUGK("COPY page for 0x%p\n", vaddr);
+    }
+}
+
+static void cow_around(u32 vaddr) {
+    if (page_free_count() <= FAULT_AROUND_PAGES * 2) {
+        return;
+    }
+
+    u32 count = 0;
+    page_entry_t *pte = get_pte(vaddr, false);
+    u32 start = AROUND_START(vaddr);
+    for (u32 page = start; page < start + AROUND_SIZE; page += PAGE_SIZE) {
+        page_entry_t *entry = &pte[TIDX(page)];
+        if (page == vaddr || !entry->present || entry->write ||
+            entry->shared || entry->readonly) {
+            continue;
+        }
+        // 只读过的零页不一定会写，不预先分配
+        if (entry->index == IDX(zero_page)) {
+            continue;
+        }
+        cow_page(entry, page);
+        count++;
+    }
+
+    if (count) {
+        around_count++;
+        around_pages += count;
+    }
+}
+
+// 只映射已在页缓存中的页，不为相邻页读盘
+static void mmap_fault_around(mmap_t *area, u32 vaddr) {
+    u32 count = 0;
+    page_entry_t *pte = get_pte(vaddr, false);
+    u32 start = AROUND_START(vaddr);
+    for (u32 page = start; page < start + AROUND_SIZE; page += PAGE_SIZE) {
+        if (page == vaddr || page < area->start || page >= area->end ||
+            pte[TIDX(page)].present) {
+            continue;
+        }
+
+        idx_t index = IDX(page - area->start + area->offset);
+        page_cache_t *cache = page_cache_find(area->inode, index);
+        if (!cache || !cache->valid) {
+            continue;
+        }
+        mmap_fault(area, page);
+        count++;
+    }
+
+    if (count) {
+        around_count++;
+        around_pages += count;
+    }
+}
+
+// 匿名页缺页，读缺页映射只读的共享零页，写入时再分配
+static void anon_fault(u32 vaddr, bool write) {
+    if (write) {
+        link_page(vaddr);
+        return;
+    }
+
+    page_entry_t *entry = get_entry(vaddr, true);
+    entry_init(entry, IDX(zero_page));
+    entry->write = false;
+    flush_tlb(vaddr);
+    zero_map_count++;
+}
+
+// 匿名页的区域为程序末尾到 brk，以及栈
+static bool anon_area(task_t *task, u32 vaddr) {
+    if (vaddr >= USER_STACK_BOTTOM && vaddr < USER_STACK_TOP) {
+        return true;
+    }
+    return vaddr >= task->end && vaddr < task->brk;
+}
+
+static void anon_fault_around(task_t *task, u32 vaddr, bool write) {
+    // 写缺页要分配物理页，内存紧张时不预先分配
+    if (write && page_free_count() <= FAULT_AROUND_PAGES * 2) {
+        return;
+    }
+
+    u32 count = 0;
+    page_entry_t *pte = get_pte(vaddr, false);
+    u32 start = AROUND_START(vaddr);
+    for (u32 page = start; page < start + AROUND_SIZE; page += PAGE_SIZE) {
+        if (page == vaddr || pte[TIDX(page)].present ||
+            !anon_area(task, page)) {
+            continue;
+        }
+        anon_fault(page, write);
+        count++;
+    }
+
+    if (count) {
+        around_count++;
+        around_pages += count;
+    }
+}
+
 void page_fault(u32 vector, u32 edi, u32 esi, u32 ebp, u32 esp, u32 ebx,
                 u32 edx, u32 ecx, u32 eax, u32 gs, u32 fs, u32 es, u32 ds,
                 u32 vector0, u32 error, u32 eip, u32 cs, u32 eflags) {
@@ -664,6 +1863,7 @@ void page_fault(u32 vector, u32 edi, u32 esi, u32 ebp, u32 esp, u32 ebx,
 
     page_error_code_t *code = (page_error_code_t *)&error;
     task_t *task = running_task();
+    fault_count++;
 
     // assert(KERNEL_MEMORY_SIZE <= vaddr && vaddr < USER_STACK_TOP);
     if (vaddr < USER_EXEC_ADDR || vaddr >= USER_STACK_TOP) {
@@ -678,30 +1878,81 @@ void page_fault(u32 vector, u32 edi, u32 esi, u32 ebp, u32 esp, u32 ebx,
         page_entry_t *entry = get_entry(vaddr, false);
 
         assert(entry->present);
+
+        // 页表共享导致的写保护，页表复制后页本身可写
+        if (entry->write) {
+            return;
+        }
+
         assert(!entry->shared);
         assert(!entry->readonly);
 
-        assert(memory_map[entry->index] > 0);
-        if (memory_map[entry->index] == 1) {
-            entry->write = true;
-            DEBUGK("WRITE page for 0x%p\n", vaddr);
-        } else {
-            void *page = (void *)PAGE(IDX(vaddr));
-            u32 paddr = copy_page(page);
-            memory_map[entry->index]--;
-            entry_init(entry, IDX(paddr));
-            flush_tlb(vaddr);
-            DEBUGK("COPY page for 0x%p\n", vaddr);
-        }
+        u32 page = PAGE(IDX(vaddr));
+        cow_page(entry, page);
+        cow_around(page);
+        return;
+    }
+
+    // 文件映射，包括程序的代码段；vfork 的子进程使用父进程的映射区域
+    mmap_t *area = mmap_find(task->vfork ? task->vfork : task, vaddr);
+    if (!code->present && area && area->inode) {
+        file_count++;
+        u32 page = PAGE(IDX(vaddr));
+        mmap_fault(area, page);
+        mmap_fault_around(area, page);
         return;
     }
 
     if (!code->present && (vaddr < task->brk || vaddr >= USER_STACK_BOTTOM)) {
         u32 page = PAGE(IDX(vaddr));
-        link_page(page);
+        anon_fault(page, code->write);
+        anon_fault_around(task, page, code->write);
         return;
     }
     DEBUGK("task 0x%p name %s brk 0x%p page fault\n", task, task->name,
            task->brk);
     panic("page fault");
 }
+
+void memory_show(proc_buf_t *pb) {
+    u32 cache_pages = 0;
+    for (size_t i = 0; i < PAGE_CACHE_HASH; i++) {
+        cache_pages += list_size(&page_cache_table[i]);
+    }
+
+    proc_printf(pb, "zones    ");
+    for (size_t i = 0; i < zone_count; i++) {
+        proc_printf(pb, " %u", zones[i].end - zones[i].start);
+    }
+    proc_printf(pb, "\n");
+    proc_printf(pb, "total     %u\n", total_pages);
+    proc_printf(pb, "free      %u\n", free_pages);
+    proc_printf(pb, "used      %u\n", used_pages);
+    u32 kernel_pages = IDX(kpage_end - kpage_start) - kpage_free;
+    proc_printf(pb, "kernel    %u\n", kernel_pages);
+    proc_printf(pb, "kfree     %u\n", kpage_free);
+    proc_printf(pb, "cache     %u\n", cache_pages);
+    proc_printf(pb, "buffer    %u\n", IDX(kernel_buffer_size));
+    proc_printf(pb, "ramdisk   %u\n", IDX(kernel_ramdisk_size));
+    proc_printf(pb, "faults    %u\n", fault_count);
+    proc_printf(pb, "cow       %u\n", cow_count);
+    proc_printf(pb, "file      %u\n", file_count);
+    proc_printf(pb, "zmap      %u\n", zero_map_count);
+    proc_printf(pb, "window    %u\n", FAULT_AROUND_PAGES);
+    proc_printf(pb, "around    %u\n", around_count);
+    proc_printf(pb, "apages    %u\n", around_pages);
+    proc_printf(pb, "ptcopy    %u\n", table_copies);
+    proc_printf(pb, "invlpg    %u\n", tlb_pages);
+    proc_printf(pb, "tlbflush  %u\n", tlb_flushes);
+    proc_printf(pb, "hot       %u\n", hot_count);
+    proc_printf(pb, "zero      %u\n", zero_count);
+    proc_printf(pb, "kzero     %u\n", zero_kcount);
+    proc_printf(pb, "zhits     %u\n", zero_hits);
+    proc_printf(pb, "zmisses   %u\n", zero_misses);
+
+    proc_printf(pb, "buddy    ");
+    for (size_t i = 0; i < BUDDY_ORDER_NR; i++) {
+        proc_printf(pb, " %u", free_blocks[i]);
+    }
+    proc_printf(pb, "\n");
+}
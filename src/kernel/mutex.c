@@ -85,3 +85,48 @@ void lock_release(lock_t *lock) {
     lock->repeat = 0;
     mutex_unlock(&lock->mutex);
 }
+
+void wait_init(wait_queue_t *queue) { list_init(&queue->entries); }
+
+// 将当前进程加入等待队列，但不阻塞
+void wait_add(wait_queue_t *queue, wait_entry_t *entry) {
+    assert(!get_interrupt_state());
+    entry->task = running_task();
+    entry->func = NULL;
+    list_push(&queue->entries, &entry->node);
+}
+
+void wait_remove(wait_entry_t *entry) {
+    assert(!get_interrupt_state());
+    list_remove(&entry->node);
+}
+
+void wait_sleep(wait_queue_t *queue) {
+    wait_entry_t entry;
+    wait_add(queue, &entry);
+    task_block(entry.task, NULL, TASK_BLOCKED);
+    wait_remove(&entry);
+}
+
+// 唤醒队列中所有的进程，由进程自己检查等待的条件
+void wait_wakeup(wait_queue_t *queue) {
+    assert(!get_interrupt_state());
+    list_t *list = &queue->entries;
+    for (list_node_t *node = list->head.next; node != &list->tail;
+         node = node->next) {
+        wait_entry_t *entry = element_entry(wait_entry_t, node, node);
+        if (entry->func) {
+            entry->func(entry);
+            continue;
+        }
+
+        task_t *task = entry->task;
+        // 进程可能在多个队列中，已经被唤醒过
+        if (task->state == TASK_SLEEPING) {
+            task->ticks = 0;
+        } else if (task->state != TASK_BLOCKED) {
+            continue;
+        }
+        task_unblock(task);
+    }
+}
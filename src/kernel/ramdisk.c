@@ -31,7 +31,7 @@ int ramdisk_ioctl(ramdisk_t *disk, int cmd, void *args, int flags) {
 int ramdisk_read(ramdisk_t *disk, void *buf, u8 count, idx_t lba) {
     void *addr = disk->start + lba * SECTOR_SIZE;
     u32 len = count * SECTOR_SIZE;
-    assert(((u32)addr + len) < (KERNEL_RAMDISK_MEM + KERNEL_MEMORY_SIZE));
+    assert(addr + len <= (void *)(disk->start + disk->size));
     memcpy(buf, addr, len);
     return count;
 }
@@ -39,7 +39,7 @@ int ramdisk_read(ramdisk_t *disk, void *buf, u8 count, idx_t lba) {
 int ramdisk_write(ramdisk_t *disk, void *buf, u8 count, idx_t lba) {
     void *addr = disk->start + lba * SECTOR_SIZE;
     u32 len = count * SECTOR_SIZE;
-    assert(((u32)addr + len) < (KERNEL_RAMDISK_MEM + KERNEL_MEMORY_SIZE));
+    assert(addr + len <= (void *)(disk->start + disk->size));
     memcpy(addr, buf, len);
     return count;
 }
@@ -47,14 +47,14 @@ int ramdisk_write(ramdisk_t *disk, void *buf, u8 count, idx_t lba) {
 void ramdisk_init() {
     DEBUGK("ramdisk init...\n");
 
-    u32 size = KERNEL_RAMDISK_SIZE / RAMDISK_NR;
+    u32 size = kernel_ramdisk_size / RAMDISK_NR;
     assert(size % SECTOR_SIZE == 0);
 
     char name[32];
 
     for (size_t i = 0; i < RAMDISK_NR; i++) {
         ramdisk_t *ramdisk = &ramdisks[i];
-        ramdisk->start = (u8 *)(KERNEL_RAMDISK_MEM + size * i);
+        ramdisk->start = (u8 *)(kernel_ramdisk_mem + size * i);
         ramdisk->size = size;
         sprintf(name, "md%c", i + 'a');
         device_install(DEV_BLOCK, DEV_RAMDISK, ramdisk, name, 0, ramdisk_ioctl,
@@ -5,6 +5,7 @@
 #include <oak/interrupt.h>
 #include <oak/io.h>
 #include <oak/mutex.h>
+#include <oak/poll.h>
 #include <oak/stdarg.h>
 #include <oak/stdio.h>
 #include <oak/task.h>
@@ -39,9 +40,8 @@ typedef struct serial_t {
     fifo_t rx_fifo;       // 读 fifo
     char rx_buf[BUF_LEN]; // 读 缓冲
     lock_t rlock;         // 读锁
-    task_t *rx_waiter;    // 读等待任务
     lock_t wlock;         // 写锁
-    task_t *tx_waiter;    // 写等待任务
+    wait_queue_t wait;    // 等待读写的任务
 } serial_t;
 
 static serial_t serials[2];
@@ -53,10 +53,7 @@ void recv_data(serial_t *serial) {
         ch = '\n';
     }
     fifo_put(&serial->rx_fifo, ch);
-    if (serial->rx_waiter != NULL) {
-        task_unblock(serial->rx_waiter);
-        serial->rx_waiter = NULL;
-    }
+    wait_wakeup(&serial->wait);
 }
 
 // 中断处理函数
@@ -73,29 +70,51 @@ void serial_handler(int vector) {
         recv_data(serial);
     }
 
-    // 如果可以发送数据，并且写进程阻塞
-    if ((state & LSR_THRE) && serial->tx_waiter) {
-        task_unblock(serial->tx_waiter);
-        serial->tx_waiter = NULL;
+    // 如果可以发送数据，唤醒写进程
+    if (state & LSR_THRE) {
+        wait_wakeup(&serial->wait);
+    }
+}
+
+int serial_ioctl(serial_t *serial, int cmd, void *args, int flags) {
+    switch (cmd) {
+    case DEV_CMD_POLL: {
+        *(wait_queue_t **)args = &serial->wait;
+        int events = 0;
+        if (!fifo_empty(&serial->rx_fifo)) {
+            events |= POLLIN;
+        }
+        if (inb(serial->iobase + COM_LINE_STATUS) & LSR_THRE) {
+            events |= POLLOUT;
+        }
+        return events;
+    }
+    default:
+        return EOF;
     }
 }
 
-int serial_read(serial_t *serial, char *buf, u32 count) {
+int serial_read(serial_t *serial, char *buf, u32 count, idx_t idx,
+                int flags) {
     lock_acquire(&serial->rlock);
     int nr = 0;
     while (nr < count) {
         while (fifo_empty(&serial->rx_fifo)) {
-            assert(serial->rx_waiter == NULL);
-            serial->rx_waiter = running_task();
-            task_block(serial->rx_waiter, NULL, TASK_BLOCKED);
+            // 非阻塞时返回已经读到的数据
+            if (flags & DEV_NONBLOCK) {
+                goto rollback;
+            }
+            wait_sleep(&serial->wait);
         }
         buf[nr++] = fifo_get(&serial->rx_fifo);
     }
+rollback:
     lock_release(&serial->rlock);
-    return nr;
+    return nr ? nr : EOF;
 }
 
-int serial_write(serial_t *serial, char *buf, u32 count) {
+int serial_write(serial_t *serial, char *buf, u32 count, idx_t idx,
+                 int flags) {
     lock_acquire(&serial->wlock);
     int nr = 0;
     while (nr < count) {
@@ -105,12 +124,13 @@ int serial_write(serial_t *serial, char *buf, u32 count) {
             outb(serial->iobase, buf[nr++]);
             continue;
         }
-        task_t *task = running_task();
-        serial->tx_waiter = task;
-        task_block(task, NULL, TASK_BLOCKED);
+        if (flags & DEV_NONBLOCK) {
+            break;
+        }
+        wait_sleep(&serial->wait);
     }
     lock_release(&serial->wlock);
-    return nr;
+    return nr ? nr : EOF;
 }
 
 // 初始化串口
@@ -118,10 +138,9 @@ void serial_init() {
     for (size_t i = 0; i < 2; i++) {
         serial_t *serial = &serials[i];
         fifo_init(&serial->rx_fifo, serial->rx_buf, BUF_LEN);
-        serial->rx_waiter = NULL;
         lock_init(&serial->rlock);
-        serial->tx_waiter = NULL;
         lock_init(&serial->wlock);
+        wait_init(&serial->wait);
 
         u16 irq;
         if (!i) {
@@ -171,8 +190,8 @@ void serial_init() {
 
         sprintf(name, "com%d", i + 1);
 
-        device_install(DEV_CHAR, DEV_SERIAL, serial, name, 0, NULL, serial_read,
-                       serial_write);
+        device_install(DEV_CHAR, DEV_SERIAL, serial, name, 0, serial_ioctl,
+                       serial_read, serial_write);
 
         DEBUGK("Serial 0x%x init...\n", serial->iobase);
     }
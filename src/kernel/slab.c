@@ -0,0 +1,201 @@
+/*
+ *  slab 对象缓存
+ *
+ *  每种对象一个缓存，缓存由若干 slab 组成，每个 slab 占一页。页开始处是 slab_t，
+ *  之后是空闲链表数组 next，然后是对象。空闲链表保存在对象之外，对象被使用者
+ *  写坏也不会破坏链表；已分配对象的 next 为 SLAB_INUSE，释放时据此检查重复释放。
+ *
+ *  slab 中放不下整数个对象的剩余空间用于着色，相邻 slab 的对象起始偏移依次错开
+ *  SLAB_COLOR 字节，使不同 slab 中相同序号的对象落在不同的高速缓存行上。
+ **/
+
+#include <oak/assert.h>
+#include <oak/debug.h>
+#include <oak/list.h>
+#include <oak/memory.h>
+#include <oak/proc.h>
+#include <oak/slab.h>
+#include <oak/string.h>
+#include <oak/types.h>
+
+#define SLAB_CACHE_NR 32
+#define SLAB_ALIGN 8  // 对象对齐
+#define SLAB_COLOR 32 // 着色的粒度，一条高速缓存行
+
+#define SLAB_MAGIC 0x51ab51ab
+#define SLAB_END 0xffff   // 空闲链表结束
+#define SLAB_INUSE 0xfffe // 对象已分配
+
+typedef struct slab_t {
+    u32 magic;           // 魔数
+    kmem_cache_t *cache; // 所属缓存
+    list_node_t node;    // 缓存链表结点
+    char *objs;          // 第一个对象
+    u16 inuse;           // 已分配的对象数量
+    u16 free;            // 第一个空闲对象
+    u16 next[];          // 空闲对象的下一个空闲对象
+} slab_t;
+
+static kmem_cache_t caches[SLAB_CACHE_NR];
+static u32 cache_count;
+
+#define ALIGN(size, align) (((size) + (align)-1) & ~((align)-1))
+
+/*
+ *  @brief  创建对象缓存
+ *  @param  name  名称
+ *  @param  size  对象大小
+ *  @param  ctor  构造函数，每个对象在 slab 创建时构造一次，可以为 NULL
+ *
+ *  创建时不分配内存，可以在内存初始化之前调用
+ */
+kmem_cache_t *kmem_cache_create(char *name, u32 size, void (*ctor)(void *)) {
+    if (cache_count == SLAB_CACHE_NR) {
+        panic("no more slab cache");
+    }
+    kmem_cache_t *cache = &caches[cache_count++];
+
+    strncpy(cache->name, name, SLAB_NAME_LEN);
+    cache->size = ALIGN(size, SLAB_ALIGN);
+    cache->ctor = ctor;
+
+    // 每个对象占 size 字节和一个空闲链表项
+    u32 count = (PAGE_SIZE - sizeof(slab_t)) / (cache->size + sizeof(u16));
+    u32 offset = ALIGN(sizeof(slab_t) + count * sizeof(u16), SLAB_ALIGN);
+    while (offset + count * cache->size > PAGE_SIZE) {
+        count--;
+        offset = ALIGN(sizeof(slab_t) + count * sizeof(u16), SLAB_ALIGN);
+    }
+    assert(count > 0 && count < SLAB_INUSE);
+
+    cache->count = count;
+    cache->offset = offset;
+    cache->colors = (PAGE_SIZE - offset - count * cache->size) / SLAB_COLOR + 1;
+    cache->color = 0;
+
+    list_init(&cache->partial);
+    list_init(&cache->full);
+    list_init(&cache->empty);
+    cache->slabs = 0;
+    cache->active = 0;
+    cache->allocs = 0;
+    cache->frees = 0;
+    return cache;
+}
+
+static slab_t *slab_create(kmem_cache_t *cache) {
+    slab_t *slab = (slab_t *)alloc_kpage(1);
+    slab->magic = SLAB_MAGIC;
+    slab->cache = cache;
+    slab->objs = (char *)slab + cache->offset + cache->color * SLAB_COLOR;
+    slab->inuse = 0;
+    slab->free = 0;
+
+    cache->color = (cache->color + 1) % cache->colors;
+    cache->slabs++;
+
+    for (size_t i = 0; i < cache->count; i++) {
+        slab->next[i] = i + 1;
+        if (cache->ctor) {
+            cache->ctor(slab->objs + i * cache->size);
+        }
+    }
+    slab->next[cache->count - 1] = SLAB_END;
+    return slab;
+}
+
+// 将 slab 加入链表，slab 较多时 list_push 的遍历检查代价较大
+static void slab_link(list_t *list, slab_t *slab) {
+    list_insert_after(&list->head, &slab->node);
+}
+
+static void slab_destroy(slab_t *slab) {
+    assert(!slab->inuse);
+    slab->cache->slabs--;
+    slab->magic = 0;
+    free_kpage((u32)slab, 1);
+}
+
+void *kmem_cache_alloc(kmem_cache_t *cache) {
+    slab_t *slab;
+    if (!list_empty(&cache->partial)) {
+        slab = element_entry(slab_t, node, cache->partial.head.next);
+    } else {
+        if (!list_empty(&cache->empty)) {
+            slab = element_entry(slab_t, node, list_pop(&cache->empty));
+        } else {
+            slab = slab_create(cache);
+        }
+        slab_link(&cache->partial, slab);
+    }
+
+    u16 idx = slab->free;
+    assert(idx < cache->count);
+    slab->free = slab->next[idx];
+    slab->next[idx] = SLAB_INUSE;
+    slab->inuse++;
+
+    // 没有空闲对象
+    if (slab->free == SLAB_END) {
+        list_remove(&slab->node);
+        slab_link(&cache->full, slab);
+    }
+
+    cache->active++;
+    cache->allocs++;
+    return slab->objs + idx * cache->size;
+}
+
+void kmem_cache_free(kmem_cache_t *cache, void *obj) {
+    slab_t *slab = (slab_t *)((u32)obj & ~(PAGE_SIZE - 1));
+    assert(slab->magic == SLAB_MAGIC);
+    assert(slab->cache == cache);
+
+    // 必须是对象的起始地址
+    assert((char *)obj >= slab->objs);
+    u32 offset = (char *)obj - slab->objs;
+    assert(offset % cache->size == 0);
+    u32 idx = offset / cache->size;
+    assert(idx < cache->count);
+
+    // 重复释放
+    assert(slab->next[idx] == SLAB_INUSE);
+
+    bool full = slab->free == SLAB_END;
+    slab->next[idx] = slab->free;
+    slab->free = idx;
+    slab->inuse--;
+
+    cache->active--;
+    cache->frees++;
+
+    if (!slab->inuse) {
+        // 保留一个空 slab，避免在边界上反复申请和释放页
+        list_remove(&slab->node);
+        if (list_empty(&cache->empty)) {
+            slab_link(&cache->empty, slab);
+        } else {
+            slab_destroy(slab);
+        }
+    } else if (full) {
+        list_remove(&slab->node);
+        slab_link(&cache->partial, slab);
+    }
+}
+
+kmem_cache_t *kmem_cache_find(void *obj) {
+    slab_t *slab = (slab_t *)((u32)obj & ~(PAGE_SIZE - 1));
+    assert(slab->magic == SLAB_MAGIC);
+    return slab->cache;
+}
+
+void slab_show(proc_buf_t *pb) {
+    proc_printf(pb, "name             size  objs slabs active allocs     "
+                    "frees\n");
+    for (size_t i = 0; i < cache_count; i++) {
+        kmem_cache_t *cache = &caches[i];
+        proc_printf(pb, "%-16s %-5u %-4u %-5u %-6u %-10u %u\n", cache->name,
+                    cache->size, cache->count, cache->slabs, cache->active,
+                    cache->allocs, cache->frees);
+    }
+}
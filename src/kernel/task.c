@@ -9,6 +9,8 @@
 #include <oak/memory.h>
 #include <oak/oak.h>
 #include <oak/printk.h>
+#include <oak/proc.h>
+#include <oak/slab.h>
 #include <oak/string.h>
 #include <oak/syscall.h>
 #include <oak/task.h>
@@ -26,18 +28,19 @@ extern void task_switch(task_t *next);
 extern void idle_thread();
 extern void init_thread();
 extern void test_thread();
+extern void truncate_thread();
 extern void foo_thread();
 
 static task_t *task_table[NR_TASKS];
 static list_t block_list;
 static list_t sleep_list;
 static task_t *idle_task;
+static kmem_cache_t *vmap_cache; // 用户进程的虚拟内存位图
 
 static task_t *get_free_task() {
     for (size_t i = 0; i < NR_TASKS; i++) {
         if (task_table[i] == NULL) {
-            task_t *task = (task_t *)alloc_kpage(1);
-            memset(task, 0, PAGE_SIZE);
+            task_t *task = (task_t *)alloc_zero_kpage();
             task->pid = i;
             task_table[i] = task;
             return task;
@@ -232,6 +235,7 @@ static task_t *task_create(target_t target, const char *name, u32 priority,
     task->uid = uid;
     task->gid = 0;
     task->vmap = &kernel_map;
+    list_init(&task->mmaps);
     task->pde = KERNEL_PAGE_DIR;
     task->brk = USER_EXEC_ADDR;
     task->text = USER_EXEC_ADDR;
@@ -259,15 +263,23 @@ static task_t *task_create(target_t target, const char *name, u32 priority,
 }
 
 extern int sys_execve(char *filename, char *argv[], char *envp[]);
+extern fd_t sys_open(char *filename, int flags, int mode);
+extern void sys_close(fd_t fd);
+extern fd_t sys_dup2(fd_t oldfd, fd_t newfd);
+
+// 创建用户态虚拟内存位图
+static void task_vmap_init(task_t *task) {
+    task->vmap = kmem_cache_alloc(vmap_cache);
+    void *buf = (void *)alloc_kpage(1);
+    bitmap_init(task->vmap, buf, USER_MMAP_SIZE / PAGE_SIZE / 8,
+                USER_MMAP_ADDR / PAGE_SIZE);
+}
 
 void task_to_user_mode() {
     task_t *task = running_task();
 
     // user mode bitmap
-    task->vmap = kmalloc(sizeof(bitmap_t));
-    void *buf = (void *)alloc_kpage(1);
-    bitmap_init(task->vmap, buf, USER_MMAP_SIZE / PAGE_SIZE / 8,
-                USER_MMAP_ADDR / PAGE_SIZE);
+    task_vmap_init(task);
 
     // user mode pde
     task->pde = (u32)copy_pde();
@@ -330,9 +342,8 @@ static void task_build_stack(task_t *task) {
     task->stack = (u32 *)frame;
 }
 
-pid_t task_fork() {
-    task_t *task = running_task();
-
+// 复制当前进程，不包括地址空间
+static task_t *task_copy(task_t *task) {
     assert(task->node.next == NULL && task->node.prev == NULL &&
            task->state == TASK_RUNNING);
 
@@ -343,16 +354,9 @@ pid_t task_fork() {
     child->pid = pid;
     child->ppid = task->pid;
     child->ticks = child->priority;
+    child->runtime = 0;
     child->state = TASK_READY;
-
-    child->vmap = kmalloc(sizeof(bitmap_t));
-    memcpy(child->vmap, task->vmap, sizeof(bitmap_t));
-
-    void *buf = (void *)alloc_kpage(1);
-    memcpy(buf, task->vmap->bits, PAGE_SIZE);
-    child->vmap->bits = buf;
-
-    child->pde = (u32)copy_pde();
+    child->vfork = NULL;
 
     child->pwd = (char *)alloc_kpage(1);
     strncpy(child->pwd, task->pwd, PAGE_SIZE);
@@ -369,12 +373,159 @@ pid_t task_fork() {
             file->count++;
         }
     }
+    return child;
+}
+
+pid_t task_fork() {
+    task_t *task = running_task();
+    task_t *child = task_copy(task);
+
+    child->vmap = kmem_cache_alloc(vmap_cache);
+    memcpy(child->vmap, task->vmap, sizeof(bitmap_t));
+
+    void *buf = (void *)alloc_kpage(1);
+    memcpy(buf, task->vmap->bits, PAGE_SIZE);
+    child->vmap->bits = buf;
+
+    child->pde = (u32)copy_pde();
+    mmap_fork(child);
 
     task_build_stack(child);
 
     return child->pid;
 }
 
+/*
+ *  @brief  创建借用当前地址空间的子进程
+ *  @return  子进程 id
+ *
+ *  子进程与父进程共用页目录、虚拟内存位图和映射区域，父进程阻塞到子进程
+ *  execve 或退出。子进程只能调用 execve 或 exit，也不能从调用 vfork 的函数返回
+ */
+pid_t task_vfork() {
+    task_t *task = running_task();
+    task_t *child = task_copy(task);
+
+    list_init(&child->mmaps);
+    child->vfork = task;
+
+    task_build_stack(child);
+
+    task_block(task, NULL, TASK_BLOCKED);
+    return child->pid;
+}
+
+// 归还父进程的地址空间，唤醒父进程
+static void task_vfork_release(task_t *task) {
+    task_t *parent = task->vfork;
+    task->vfork = NULL;
+    assert(parent->state == TASK_BLOCKED);
+    task_unblock(parent);
+}
+
+/*
+ *  @brief  vfork 的子进程执行 execve 时换用自己的地址空间
+ *
+ *  参数拷贝到内核之后、写入用户栈之前调用，新地址空间只有内核映射
+ */
+void task_vfork_exec() {
+    task_t *task = running_task();
+    if (!task->vfork) {
+        return;
+    }
+
+    task_vmap_init(task);
+    task->pde = (u32)create_pde();
+    set_cr3(task->pde);
+
+    task->end = USER_EXEC_ADDR;
+    task->brk = USER_EXEC_ADDR;
+
+    task_vfork_release(task);
+}
+
+// 依次执行 spawn 的文件操作
+static int task_spawn_actions(spawn_action_t *actions, int count) {
+    for (int i = 0; i < count; i++) {
+        spawn_action_t *action = &actions[i];
+        if ((u32)action->fd >= TASK_FILE_NR) {
+            return EOF;
+        }
+
+        switch (action->type) {
+        case SPAWN_CLOSE:
+            sys_close(action->fd);
+            break;
+        case SPAWN_DUP2:
+            if ((u32)action->newfd >= TASK_FILE_NR ||
+                sys_dup2(action->fd, action->newfd) == EOF) {
+                return EOF;
+            }
+            break;
+        case SPAWN_OPEN: {
+            fd_t fd = sys_open(action->filename, action->flags, action->mode);
+            if (fd == EOF) {
+                return EOF;
+            }
+            if (fd != action->fd) {
+                fd_t ret = sys_dup2(fd, action->fd);
+                sys_close(fd);
+                if (ret == EOF) {
+                    return EOF;
+                }
+            }
+            break;
+        }
+        default:
+            return EOF;
+        }
+    }
+    return 0;
+}
+
+// spawn 的子进程从这里开始执行，参数在 spawn 系统调用的中断帧中
+static void task_spawn_entry() {
+    task_t *task = running_task();
+    intr_frame_t *iframe =
+        (intr_frame_t *)((u32)task + PAGE_SIZE - sizeof(intr_frame_t));
+
+    int ret = task_spawn_actions((spawn_action_t *)iframe->esi, iframe->edi);
+    if (ret != EOF) {
+        // 成功时直接返回用户态执行新程序
+        ret = sys_execve((char *)iframe->ebx, (char **)iframe->ecx,
+                         (char **)iframe->edx);
+    }
+    task_exit(ret);
+}
+
+/*
+ *  @brief  创建子进程执行程序
+ *  @param  filename  程序文件
+ *  @param  argv  参数
+ *  @param  envp  环境变量
+ *  @param  actions  子进程执行程序之前依次执行的文件操作
+ *  @param  count  文件操作的数量
+ *  @return  子进程 id
+ *
+ *  子进程与 vfork 一样借用父进程的地址空间，在内核中完成文件操作和 execve，
+ *  不经过用户态。失败时子进程以 EOF 状态退出，与 fork 之后 execve 失败一致
+ */
+pid_t task_spawn(char *filename, char *argv[], char *envp[],
+                 spawn_action_t *actions, int count) {
+    task_t *task = running_task();
+    task_t *child = task_copy(task);
+
+    list_init(&child->mmaps);
+    child->vfork = task;
+
+    task_build_stack(child);
+    task_frame_t *frame = (task_frame_t *)child->stack;
+    frame->eip = task_spawn_entry;
+
+    task_block(task, NULL, TASK_BLOCKED);
+    return child->pid;
+}
+
 void task_exit(int status) {
     task_t *task = running_task();
 
@@ -384,10 +535,16 @@ void task_exit(int status) {
     task->state = TASK_DIED;
     task->status = status;
 
-    free_pde();
+    // vfork 的子进程的地址空间属于父进程
+    if (task->vfork) {
+        task_vfork_release(task);
+    } else {
+        mmap_exit();
+        free_pde();
 
-    free_kpage((u32)task->vmap->bits, 1);
-    kfree(task->vmap);
+        free_kpage((u32)task->vmap->bits, 1);
+        kmem_cache_free(vmap_cache, task->vmap);
+    }
 
     free_kpage((u32)task->pwd, 1);
     iput(task->ipwd);
@@ -465,6 +622,23 @@ rollback:
     return ret;
 }
 
+void task_show(proc_buf_t *pb) {
+    static char *states[] = {
+        "init", "ready", "running", "blocked", "sleeping", "waiting", "died",
+    };
+
+    proc_printf(pb, "pid  ppid uid   state    prio runtime  name\n");
+    for (size_t i = 0; i < NR_TASKS; i++) {
+        task_t *task = task_table[i];
+        if (!task) {
+            continue;
+        }
+        proc_printf(pb, "%-4d %-4d %-5d %-8s %-4d %-8u %s\n", task->pid,
+                    task->ppid, task->uid, states[task->state], task->priority,
+                    task->runtime, task->name);
+    }
+}
+
 static void task_setup() {
     task_t *task = running_task();
     task->magic = OAK_MAGIC;
@@ -476,10 +650,12 @@ static void task_setup() {
 void task_init() {
     list_init(&block_list);
     list_init(&sleep_list);
+    vmap_cache = kmem_cache_create("bitmap_t", sizeof(bitmap_t), NULL);
     task_setup();
 
     idle_task = task_create(idle_thread, "idle", 1, KERNEL_USER);
     task_create(init_thread, "init", 5, NORMAL_USER);
     task_create(test_thread, "test", 5, NORMAL_USER);
+    task_create(truncate_thread, "truncate", 3, KERNEL_USER);
     // task_create(foo_thread, "foo", 5, NORMAL_USER);
 }
@@ -1,6 +1,7 @@
 #include <oak/arena.h>
 #include <oak/debug.h>
 #include <oak/interrupt.h>
+#include <oak/memory.h>
 #include <oak/printk.h>
 #include <oak/stdio.h>
 #include <oak/stdlib.h>
@@ -18,6 +19,8 @@ void idle_thread() {
 
     while (true) {
         // DEBUGK("idle task...%d\n", counter++);
+        // 空闲时预先清零空闲页
+        zero_refill();
         asm volatile("sti\n"
                      "hlt\n");
         yield();
@@ -27,6 +30,10 @@ void idle_thread() {
 void init_thread() {
     char tmp[100];
     dev_init();
+
+    // 内核统计信息
+    mkdir("/proc", 0755);
+    mount(NULL, "/proc", "proc", 0);
     task_to_user_mode();
 }
 
@@ -1,5 +1,7 @@
 #include <oak/assert.h>
 #include <oak/fifo.h>
+#include <oak/stdlib.h>
+#include <oak/string.h>
 #include <oak/types.h>
 
 static _inline u32 fifo_next(fifo_t *fifo, u32 pos) {
@@ -26,6 +28,63 @@ char fifo_get(fifo_t *fifo) {
     return byte;
 }
 
+// contiguous bytes which can be got from tail, without wrapping
+u32 fifo_span(fifo_t *fifo, char **ptr) {
+    *ptr = fifo->buf + fifo->tail;
+    if (fifo->head >= fifo->tail) {
+        return fifo->head - fifo->tail;
+    }
+    return fifo->length - fifo->tail;
+}
+
+// discard count bytes from tail
+void fifo_skip(fifo_t *fifo, u32 count) {
+    char *ptr;
+    assert(count <= fifo_span(fifo, &ptr));
+    fifo->tail = (fifo->tail + count) % fifo->length;
+}
+
+// bytes in fifo
+u32 fifo_used(fifo_t *fifo) {
+    return (fifo->head + fifo->length - fifo->tail) % fifo->length;
+}
+
+// bytes can be put into fifo, one byte is kept to tell full from empty
+u32 fifo_free(fifo_t *fifo) { return fifo->length - 1 - fifo_used(fifo); }
+
+// get at most count bytes into buf, copy contiguous spans at once
+u32 fifo_read(fifo_t *fifo, char *buf, u32 count) {
+    u32 nr = 0;
+    while (nr < count && !fifo_empty(fifo)) {
+        char *ptr;
+        u32 span = fifo_span(fifo, &ptr);
+        u32 chars = MIN(span, count - nr);
+        memcpy(buf + nr, ptr, chars);
+        fifo_skip(fifo, chars);
+        nr += chars;
+    }
+    return nr;
+}
+
+// put at most count bytes of buf without discarding, return bytes put
+u32 fifo_write(fifo_t *fifo, char *buf, u32 count) {
+    u32 nr = 0;
+    while (nr < count && !fifo_full(fifo)) {
+        u32 end = fifo->length;
+        // keep the byte before tail empty
+        if (fifo->tail > fifo->head) {
+            end = fifo->tail - 1;
+        } else if (fifo->tail == 0) {
+            end = fifo->length - 1;
+        }
+        u32 chars = MIN(end - fifo->head, count - nr);
+        memcpy(fifo->buf + fifo->head, buf + nr, chars);
+        fifo->head = (fifo->head + chars) % fifo->length;
+        nr += chars;
+    }
+    return nr;
+}
+
 void fifo_put(fifo_t *fifo, char byte) {
     // discard first one if full
     while (fifo_full(fifo)) {
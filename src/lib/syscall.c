@@ -94,6 +94,64 @@ int write(fd_t fd, char *buf, int len) {
     return _syscall3(SYS_NR_WRITE, fd, (u32)buf, len);
 }
 
+int pread(fd_t fd, char *buf, int len, off_t offset) {
+    return _syscall4(SYS_NR_PREAD, fd, (u32)buf, len, offset);
+}
+
+int pwrite(fd_t fd, char *buf, int len, off_t offset) {
+    return _syscall4(SYS_NR_PWRITE, fd, (u32)buf, len, offset);
+}
+
+int readv(fd_t fd, iovec_t *iov, int iovcnt) {
+    return _syscall3(SYS_NR_READV, fd, (u32)iov, iovcnt);
+}
+
+int writev(fd_t fd, iovec_t *iov, int iovcnt) {
+    return _syscall3(SYS_NR_WRITEV, fd, (u32)iov, iovcnt);
+}
+
+int fcntl(fd_t fd, int cmd, int arg) {
+    return _syscall3(SYS_NR_FCNTL, fd, cmd, arg);
+}
+
+int poll(pollfd_t *fds, int nfds, int timeout) {
+    return _syscall3(SYS_NR_POLL, (u32)fds, nfds, timeout);
+}
+
+int select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds,
+           int timeout) {
+    return _syscall5(SYS_NR_SELECT, nfds, (u32)readfds, (u32)writefds,
+                     (u32)exceptfds, timeout);
+}
+
+fd_t epoll_create(int size) { return _syscall1(SYS_NR_EPOLL_CREATE, size); }
+
+int epoll_ctl(fd_t epfd, int op, fd_t fd, epoll_event_t *event) {
+    return _syscall4(SYS_NR_EPOLL_CTL, epfd, op, fd, (u32)event);
+}
+
+int epoll_wait(fd_t epfd, epoll_event_t *events, int maxevents, int timeout) {
+    return _syscall4(SYS_NR_EPOLL_WAIT, epfd, (u32)events, maxevents, timeout);
+}
+
+fd_t uring_setup(u32 entries, uring_params_t *params) {
+    return _syscall2(SYS_NR_URING_SETUP, entries, (u32)params);
+}
+
+int uring_enter(fd_t fd, u32 to_submit) {
+    return _syscall2(SYS_NR_URING_ENTER, fd, to_submit);
+}
+
+int sendfile(fd_t out_fd, fd_t in_fd, off_t *offset, int count) {
+    return _syscall4(SYS_NR_SENDFILE, out_fd, in_fd, (u32)offset, count);
+}
+
+int splice(fd_t in_fd, off_t *in_offset, fd_t out_fd, off_t *out_offset,
+           int count, int flags) {
+    return _syscall6(SYS_NR_SPLICE, in_fd, (u32)in_offset, out_fd,
+                     (u32)out_offset, count, flags);
+}
+
 int lseek(fd_t fd, off_t offset, int whence) {
     return _syscall3(SYS_NR_LSEEK, fd, offset, whence);
 }
@@ -102,6 +160,10 @@ int readdir(fd_t fd, void *dir, int count) {
     return _syscall3(SYS_NR_READDIR, fd, (u32)dir, (u32)count);
 }
 
+int getdents(fd_t fd, void *dirp, u32 count) {
+    return _syscall3(SYS_NR_GETDENTS, fd, (u32)dirp, count);
+}
+
 char *getcwd(char *buf, size_t size) {
     return (char *)_syscall2(SYS_NR_GETCWD, (u32)buf, (u32)size);
 }
@@ -121,8 +183,9 @@ int link(char *oldname, char *newname) {
 }
 int unlink(char *filename) { return _syscall1(SYS_NR_UNLINK, (u32)filename); }
 
-int mount(char *devname, char *dirname, int flags) {
-    return _syscall3(SYS_NR_MOUNT, (u32)devname, (u32)dirname, (u32)flags);
+int mount(char *devname, char *dirname, char *type, int flags) {
+    return _syscall4(SYS_NR_MOUNT, (u32)devname, (u32)dirname, (u32)type,
+                     (u32)flags);
 }
 
 int umount(char *target) { return _syscall1(SYS_NR_UMOUNT, (u32)target); }
@@ -150,6 +213,11 @@ int munmap(void *addr, size_t length) {
 pid_t get_pid() { return _syscall0(SYS_NR_GETPID); }
 pid_t get_ppid() { return _syscall0(SYS_NR_GETPPID); }
 pid_t fork() { return _syscall0(SYS_NR_FORK); }
+pid_t spawn(char *filename, char *argv[], char *envp[],
+            spawn_action_t *actions, int count) {
+    return _syscall5(SYS_NR_SPAWN, (u32)filename, (u32)argv, (u32)envp,
+                     (u32)actions, count);
+}
 void exit(int status) { _syscall1(SYS_NR_EXIT, (u32)status); }
 pid_t waitpid(pid_t pid, int32 *status) {
     return _syscall2(SYS_NR_WAITPID, pid, (u32)status);
@@ -164,6 +232,10 @@ int fstat(fd_t fd, stat_t *statbuf) {
     return _syscall2(SYS_NR_FSTAT, (u32)fd, (u32)statbuf);
 }
 
+int fstatat(fd_t dirfd, char *filename, stat_t *statbuf) {
+    return _syscall3(SYS_NR_FSTATAT, (u32)dirfd, (u32)filename, (u32)statbuf);
+}
+
 int mkfs(char *devname, int icount) {
     return _syscall2(SYS_NR_MKFS, (u32)devname, (u32)icount);
 }
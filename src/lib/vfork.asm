@@ -0,0 +1,14 @@
+[bits 32]
+
+section .text
+global vfork
+
+; vfork 的子进程与父进程共用用户栈，子进程返回之后调用其他函数会覆盖
+; 栈中的返回地址，父进程恢复执行时就无法返回。因此系统调用期间返回地址
+; 保存在 ecx 中，父子进程各自压回栈中再返回
+vfork:
+    pop ecx; 返回地址
+    mov eax, 190; SYS_NR_VFORK
+    int 0x80
+    push ecx
+    ret
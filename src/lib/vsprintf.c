@@ -13,6 +13,16 @@
 
 #define is_digit(c) ((c) >= '0' && (c) <= '9')
 
+// 写入一个字符，超出 end 的部分只计数不写入
+#define PUT(c)                                                                 \
+    do {                                                                       \
+        char __c = (c);                                                        \
+        if (str < end) {                                                       \
+            *str = __c;                                                        \
+        }                                                                      \
+        str++;                                                                 \
+    } while (0)
+
 static int skip_atoi(const char **s) {
     int i = 0;
 
@@ -23,13 +33,14 @@ static int skip_atoi(const char **s) {
 }
 
 // str: the output string
+// end: end of the output buffer
 // num: variadic parameters in printk
 // base: base number
 // size: width
 // precision: precision
 // flags: flags
-static char *number(char *str, unsigned long num, int base, int size,
-                    int precision, int flags) {
+static char *number(char *str, char *end, unsigned long num, int base,
+                    int size, int precision, int flags) {
     // padding: ` ` or `0` for padding
     // sign: `-` or `+` for signed number
     // tmp: temporary buffer
@@ -97,51 +108,53 @@ static char *number(char *str, unsigned long num, int base, int size,
     // non 0 padding, non left alignment, pad with space
     if (!(flags & (ZEROPAD + LEFT))) {
         while (size-- > 0) {
-            *str++ = ' ';
+            PUT(' ');
         }
     }
 
     // write sign
     if (sign) {
-        *str++ = sign;
+        PUT(sign);
     }
 
     // write special sign of base
     if (flags & SPECIAL) {
         if (base == 8) {
-            *str++ = '0';
+            PUT('0');
         } else if (base == 16) {
-            *str++ = '0';
-            *str++ = digits[33];
+            PUT('0');
+            PUT(digits[33]);
         }
     }
 
     // non left alignment
     if (!(flags & LEFT)) {
         while (size-- > 0) {
-            *str++ = padding;
+            PUT(padding);
         }
     }
 
     // precision padding
     while (i < precision--) {
-        *str++ = '0';
+        PUT('0');
     }
 
     // write  strings after conversion reversely
     while (i-- > 0) {
-        *str++ = tmp[i];
+        PUT(tmp[i]);
     }
 
     // left alignment, pad with space
     while ((size-- > 0)) {
-        *str++ = ' ';
+        PUT(' ');
     }
     return str;
 }
 
 // %[flags][width][.precision][length]specifier
-int vsprintf(char *buf, const char *fmt, va_list args) {
+// 最多写入 size 个字符，包括结尾的 0，返回完整输出的长度
+int vsnprintf(char *buf, size_t size, const char *fmt, va_list args) {
+    char *end = buf + size;
 
     // handle %s
     int len;
@@ -160,7 +173,7 @@ int vsprintf(char *buf, const char *fmt, va_list args) {
     for (str = buf; *fmt; ++fmt) {
         // write non-formatted characters to `str`
         if (*fmt != '%') {
-            *str++ = *fmt;
+            PUT(*fmt);
             continue;
         }
 
@@ -245,19 +258,23 @@ int vsprintf(char *buf, const char *fmt, va_list args) {
             // right alignment
             if (!(flags & LEFT)) {
                 while (--field_width > 0) {
-                    *str++ = ' ';
+                    PUT(' ');
                 }
             }
-            *str++ = (unsigned char)va_arg(args, int);
+            PUT((unsigned char)va_arg(args, int));
 
             // left alignment
             while (--field_width > 0) {
-                *str++ = ' ';
+                PUT(' ');
             }
             break;
             // string
         case 's':
             s = va_arg(args, char *);
+            // 空指针所在的页没有映射
+            if (!s) {
+                s = "(null)";
+            }
             len = strlen(s);
 
             // ignore substract sign
@@ -271,23 +288,23 @@ int vsprintf(char *buf, const char *fmt, va_list args) {
             // right alignment, pad space
             if (!(flags & LEFT)) {
                 while (len < field_width--) {
-                    *str++ = ' ';
+                    PUT(' ');
                 }
             }
 
             // write string to output string
             for (int i = 0; i < len; i++) {
-                *str++ = *s++;
+                PUT(*s++);
             }
 
             // left alignment
             while (--field_width > len) {
-                *str++ = ' ';
+                PUT(' ');
             }
             break;
             // octal integer
         case 'o':
-            str = number(str, va_arg(args, unsigned long), 8, field_width,
+            str = number(str, end, va_arg(args, unsigned long), 8, field_width,
                          precision, flags);
             break;
             // pointer
@@ -296,14 +313,14 @@ int vsprintf(char *buf, const char *fmt, va_list args) {
                 field_width = 8;
                 flags |= ZEROPAD;
             }
-            str = number(str, (unsigned long)va_arg(args, void *), 16,
+            str = number(str, end, (unsigned long)va_arg(args, void *), 16,
                          field_width, precision, flags);
             break;
             // hexadecimal
         case 'x':
             flags |= SMALL;
         case 'X':
-            str = number(str, va_arg(args, unsigned long), 16, field_width,
+            str = number(str, end, va_arg(args, unsigned long), 16, field_width,
                          precision, flags);
             break;
             // decimal
@@ -311,7 +328,7 @@ int vsprintf(char *buf, const char *fmt, va_list args) {
         case 'i':
             flags |= SIGN;
         case 'u':
-            str = number(str, va_arg(args, unsigned long), 10, field_width,
+            str = number(str, end, va_arg(args, unsigned long), 10, field_width,
                          precision, flags);
             break;
         case 'n':
@@ -320,19 +337,24 @@ int vsprintf(char *buf, const char *fmt, va_list args) {
             break;
         default:
             if (*fmt != '%') {
-                *str++ = '%';
+                PUT('%');
             }
             if (*fmt) {
-                *str++ = *fmt;
+                PUT(*fmt);
             } else {
                 --fmt;
             }
             break;
         }
     }
-    *str = '\0';
+    if (size) {
+        *(str < end ? str : end - 1) = '\0';
+    }
+    return str - buf;
+}
 
-    int tmp = str - buf;
+int vsprintf(char *buf, const char *fmt, va_list args) {
+    int tmp = vsnprintf(buf, 1024, fmt, args);
     assert(tmp < 1024);
     return tmp;
 }